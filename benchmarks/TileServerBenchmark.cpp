@@ -0,0 +1,394 @@
+/***************************************************************************
+ *   Copyright (C) 2023 by Stefan Kebekus                                  *
+ *   stefan.kebekus@gmail.com                                              *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 3 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, write to the                         *
+ *   Free Software Foundation, Inc.,                                       *
+ *   59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.             *
+ ***************************************************************************/
+
+/* Benchmark for the tile path
+ *
+ * This program opens one or more MBTILES files, replays a trace of tile
+ * requests and reports latency and throughput. The requests are processed
+ * twice: once by calling TileHandler::processTile() directly, which measures
+ * database access and caching, and once over loopback HTTP against a
+ * TileServer, which also includes the worker threads and the HTTP stack.
+ *
+ * Traces are text files with one request per line, in the form "z/x/y", with
+ * y counted from the north. Empty lines and lines starting with '#' are
+ * ignored. Without a trace, the program generates a random sequence of pans
+ * and zooms over the area covered by the first file.
+ *
+ * Example: tileServerBenchmark --repeat 3 europe.mbtiles africa.mbtiles
+ */
+
+#include <QCommandLineParser>
+#include <QCoreApplication>
+#include <QElapsedTimer>
+#include <QEventLoop>
+#include <QFile>
+#include <QNetworkAccessManager>
+#include <QNetworkReply>
+#include <QPointer>
+#include <QRandomGenerator>
+#include <QSet>
+#include <QTextStream>
+#include <QtMath>
+#include <algorithm>
+#include <functional>
+
+#include "geomaps/MBTILES.h"
+#include "geomaps/TileCache.h"
+#include "geomaps/TileHandler.h"
+#include "geomaps/TileServer.h"
+
+
+namespace {
+
+// Tile request, with y counted from the north
+struct Tile {
+    int zoom {0};
+    int x {0};
+    int y {0};
+};
+
+// Result of one pass over the trace
+struct Statistics {
+    QVector<qint64> latenciesNS;
+    qint64 elapsedNS {0};
+    qsizetype notFound {0};
+    qsizetype failed {0};
+};
+
+
+// Reads a trace file. Returns an empty list on error.
+auto readTrace(const QString& fileName) -> QVector<Tile>
+{
+    QVector<Tile> result;
+    QFile file(fileName);
+    if (!file.open(QIODevice::ReadOnly | QIODevice::Text))
+    {
+        return result;
+    }
+    while (!file.atEnd())
+    {
+        auto line = QString::fromUtf8(file.readLine()).trimmed();
+        if (line.isEmpty() || line.startsWith('#'))
+        {
+            continue;
+        }
+        auto elements = line.split('/');
+        if (elements.size() != 3)
+        {
+            continue;
+        }
+        result.append({elements[0].toInt(), elements[1].toInt(), elements[2].section('.', 0, 0).toInt()});
+    }
+    return result;
+}
+
+
+// Generates a random sequence of pans and zooms, as a map of 5x4 tiles would
+// produce it. Only tiles that were not visible in the previous step are
+// requested, because the map keeps visible tiles.
+auto syntheticTrace(const QMap<QString, QString>& metaData, qsizetype steps, quint32 seed) -> QVector<Tile>
+{
+    QRandomGenerator generator(seed);
+
+    bool ok = false;
+    auto minZoom = metaData.value(QStringLiteral("minzoom")).toInt(&ok);
+    if (!ok)
+    {
+        minZoom = 0;
+    }
+    auto maxZoom = metaData.value(QStringLiteral("maxzoom")).toInt(&ok);
+    if (!ok)
+    {
+        maxZoom = 14;
+    }
+    auto zoom = qBound(minZoom, 8, maxZoom);
+
+    // Start in the center of the bounds, given as "left,bottom,right,top"
+    double longitude = 0.0;
+    double latitude = 0.0;
+    auto bounds = metaData.value(QStringLiteral("bounds")).split(',');
+    if (bounds.size() == 4)
+    {
+        longitude = (bounds[0].toDouble()+bounds[2].toDouble())/2.0;
+        latitude = (bounds[1].toDouble()+bounds[3].toDouble())/2.0;
+    }
+    auto x = (longitude+180.0)/360.0*(1<<zoom);
+    auto y = (1.0-asinh(tan(qDegreesToRadians(latitude)))/M_PI)/2.0*(1<<zoom);
+
+    QVector<Tile> result;
+    QSet<QString> visible;
+    for(qsizetype step=0; step<steps; step++)
+    {
+        QSet<QString> nowVisible;
+        auto numTiles = 1<<zoom;
+        for(auto tileX = qFloor(x)-2; tileX <= qFloor(x)+2; tileX++)
+        {
+            for(auto tileY = qFloor(y)-2; tileY <= qFloor(y)+1; tileY++)
+            {
+                if ((tileY < 0) || (tileY >= numTiles))
+                {
+                    continue;
+                }
+                Tile tile {zoom, (tileX+numTiles) % numTiles, tileY};
+                auto key = QStringLiteral("%1/%2/%3").arg(tile.zoom).arg(tile.x).arg(tile.y);
+                if (nowVisible.contains(key))
+                {
+                    continue;
+                }
+                nowVisible.insert(key);
+                if (!visible.contains(key))
+                {
+                    result.append(tile);
+                }
+            }
+        }
+        visible = nowVisible;
+
+        // Pan by one tile in a random direction, or zoom in or out
+        auto action = generator.bounded(10);
+        if ((action == 0) && (zoom < maxZoom))
+        {
+            zoom++;
+            x *= 2.0;
+            y *= 2.0;
+        }
+        else if ((action == 1) && (zoom > minZoom))
+        {
+            zoom--;
+            x /= 2.0;
+            y /= 2.0;
+        }
+        else
+        {
+            auto direction = generator.bounded(4);
+            x += (direction == 0) ? 1.0 : (direction == 1) ? -1.0 : 0.0;
+            y += (direction == 2) ? 1.0 : (direction == 3) ? -1.0 : 0.0;
+            x = fmod(x+(1<<zoom), 1<<zoom);
+            y = qBound(0.0, y, (1<<zoom)-1.0);
+        }
+    }
+    return result;
+}
+
+
+// Processes the trace by calling TileHandler::processTile() directly
+auto runDirect(GeoMaps::TileHandler& handler, const QVector<Tile>& trace) -> Statistics
+{
+    Statistics result;
+    result.latenciesNS.reserve(trace.size());
+    QElapsedTimer total;
+    total.start();
+    foreach(auto tile, trace)
+    {
+        QElapsedTimer timer;
+        timer.start();
+        auto reply = handler.processTile(tile.zoom, tile.x, tile.y);
+        result.latenciesNS.append(timer.nsecsElapsed());
+        if (reply.status == QHttpServerResponder::StatusCode::NotFound)
+        {
+            result.notFound++;
+        }
+    }
+    result.elapsedNS = total.nsecsElapsed();
+    return result;
+}
+
+
+// Processes the trace over HTTP, with a given number of requests in flight
+auto runHttp(const QString& baseURL, const QVector<Tile>& trace, int concurrency) -> Statistics
+{
+    Statistics result;
+    result.latenciesNS.reserve(trace.size());
+
+    QNetworkAccessManager manager;
+    QEventLoop loop;
+    qsizetype next = 0;
+    qsizetype pending = 0;
+    QElapsedTimer total;
+    total.start();
+
+    std::function<void()> startNext = [&]() {
+        if (next >= trace.size())
+        {
+            if (pending == 0)
+            {
+                loop.quit();
+            }
+            return;
+        }
+        auto tile = trace[next++];
+        QElapsedTimer timer;
+        timer.start();
+        auto* reply = manager.get(QNetworkRequest(QUrl(QStringLiteral("%1/%2/%3/%4.tile").arg(baseURL).arg(tile.zoom).arg(tile.x).arg(tile.y))));
+        pending++;
+        QObject::connect(reply, &QNetworkReply::finished, &loop, [&, reply, timer]() {
+            result.latenciesNS.append(timer.nsecsElapsed());
+            auto status = reply->attribute(QNetworkRequest::HttpStatusCodeAttribute).toInt();
+            if (status == 404)
+            {
+                result.notFound++;
+            }
+            else if (reply->error() != QNetworkReply::NoError)
+            {
+                result.failed++;
+            }
+            (void)reply->readAll();
+            reply->deleteLater();
+            pending--;
+            startNext();
+        });
+    };
+
+    for(int i=0; i<concurrency; i++)
+    {
+        startNext();
+    }
+    if (pending > 0)
+    {
+        loop.exec();
+    }
+    result.elapsedNS = total.nsecsElapsed();
+    return result;
+}
+
+
+// Prints one line of results
+void report(QTextStream& stream, const QString& title, Statistics statistics)
+{
+    auto& latencies = statistics.latenciesNS;
+    if (latencies.isEmpty())
+    {
+        stream << title << ": no requests" << Qt::endl;
+        return;
+    }
+    std::sort(latencies.begin(), latencies.end());
+    auto percentile = [&latencies](double p) {
+        auto index = qBound(qsizetype(0), static_cast<qsizetype>(qCeil(p*latencies.size()))-1, latencies.size()-1);
+        return latencies[index]/1.0e6;
+    };
+    auto tilesPerSecond = latencies.size()/(statistics.elapsedNS/1.0e9);
+
+    stream << title << ": "
+           << latencies.size() << " requests, "
+           << statistics.notFound << " not found, "
+           << statistics.failed << " failed, "
+           << QString::number(tilesPerSecond, 'f', 1) << " tiles/s, "
+           << "p50 " << QString::number(percentile(0.5), 'f', 3) << " ms, "
+           << "p99 " << QString::number(percentile(0.99), 'f', 3) << " ms, "
+           << "max " << QString::number(latencies.last()/1.0e6, 'f', 3) << " ms"
+           << Qt::endl;
+}
+
+} // namespace
+
+
+auto main(int argc, char *argv[]) -> int
+{
+    QCoreApplication app(argc, argv);
+    QCoreApplication::setApplicationName(QStringLiteral("tileServerBenchmark"));
+
+    QCommandLineParser parser;
+    parser.setApplicationDescription(QStringLiteral("Measures latency and throughput of the tile server."));
+    parser.addHelpOption();
+    parser.addPositionalArgument(QStringLiteral("files"), QStringLiteral("MBTILES files that form one tile set."), QStringLiteral("files..."));
+    QCommandLineOption traceOption(QStringLiteral("trace"), QStringLiteral("Trace file with one request \"z/x/y\" per line."), QStringLiteral("file"));
+    QCommandLineOption stepsOption(QStringLiteral("steps"), QStringLiteral("Number of pans and zooms in the synthetic trace (default 500)."), QStringLiteral("number"), QStringLiteral("500"));
+    QCommandLineOption seedOption(QStringLiteral("seed"), QStringLiteral("Seed for the synthetic trace (default 1)."), QStringLiteral("number"), QStringLiteral("1"));
+    QCommandLineOption repeatOption(QStringLiteral("repeat"), QStringLiteral("Number of passes over the trace (default 2)."), QStringLiteral("number"), QStringLiteral("2"));
+    QCommandLineOption concurrencyOption(QStringLiteral("concurrency"), QStringLiteral("HTTP requests in flight (default 6)."), QStringLiteral("number"), QStringLiteral("6"));
+    QCommandLineOption cacheOption(QStringLiteral("cache"), QStringLiteral("Size of the tile cache in MiB (default 64)."), QStringLiteral("MiB"), QStringLiteral("64"));
+    parser.addOptions({traceOption, stepsOption, seedOption, repeatOption, concurrencyOption, cacheOption});
+    parser.process(app);
+
+    QTextStream out(stdout);
+    QTextStream err(stderr);
+
+    //
+    // Open files
+    //
+    if (parser.positionalArguments().isEmpty())
+    {
+        parser.showHelp(1);
+    }
+    QVector<QPointer<GeoMaps::MBTILES>> files;
+    foreach(auto fileName, parser.positionalArguments())
+    {
+        if (!QFile::exists(fileName))
+        {
+            err << "File not found: " << fileName << Qt::endl;
+            return 1;
+        }
+        files.append(new GeoMaps::MBTILES(fileName, &app));
+    }
+
+    //
+    // Read or generate trace
+    //
+    QVector<Tile> trace;
+    if (parser.isSet(traceOption))
+    {
+        trace = readTrace(parser.value(traceOption));
+    }
+    else
+    {
+        trace = syntheticTrace(files[0]->metaData(), parser.value(stepsOption).toLongLong(), parser.value(seedOption).toUInt());
+    }
+    if (trace.isEmpty())
+    {
+        err << "Trace is empty" << Qt::endl;
+        return 1;
+    }
+    auto repeat = qMax(1, parser.value(repeatOption).toInt());
+    auto concurrency = qMax(1, parser.value(concurrencyOption).toInt());
+    auto cacheSize = static_cast<size_t>(qMax(0, parser.value(cacheOption).toInt()))*1024*1024;
+    out << "Trace with " << trace.size() << " requests, tile cache " << cacheSize/(1024*1024) << " MiB" << Qt::endl;
+
+    //
+    // Direct calls to TileHandler
+    //
+    {
+        QSharedPointer<GeoMaps::TileCache> tileCache(new GeoMaps::TileCache(static_cast<qsizetype>(cacheSize)));
+        GeoMaps::TileHandler handler(files, QStringLiteral("benchmark"), tileCache);
+        for(int pass=1; pass<=repeat; pass++)
+        {
+            report(out, QStringLiteral("TileHandler, pass %1").arg(pass), runDirect(handler, trace));
+        }
+    }
+
+    //
+    // Requests to TileServer over loopback
+    //
+    {
+        GeoMaps::TileServer server(cacheSize);
+        server.addMbtilesFileSet(QStringLiteral("benchmark"), files);
+        if (server.serverUrl().isEmpty())
+        {
+            err << "Tile server is not listening" << Qt::endl;
+            return 1;
+        }
+        for(int pass=1; pass<=repeat; pass++)
+        {
+            report(out, QStringLiteral("TileServer, pass %1").arg(pass), runHttp(server.serverUrl()+u"/benchmark"_qs, trace, concurrency));
+        }
+        out << "Tile cache hit rate: " << QString::number(100.0*server.tileCache().hitRate(), 'f', 1) << " %" << Qt::endl;
+    }
+
+    return 0;
+}
@@ -75,6 +75,20 @@ auto GlobalSettings::lastValidAirspaceAltitudeLimit() const -> Units::Distance
 }
 
 
+auto GlobalSettings::tileCacheSize() const -> Units::ByteSize
+{
+    auto size = static_cast<size_t>(settings.value(QStringLiteral("Map/tileCacheSize"), static_cast<qulonglong>(tileCacheSize_default)).toULongLong());
+    return qBound(tileCacheSize_min, size, tileCacheSize_max);
+}
+
+
+auto GlobalSettings::trafficTargets() const -> int
+{
+    auto targets = settings.value(QStringLiteral("Traffic/targets"), trafficTargets_default).toInt();
+    return qBound(trafficTargets_min, targets, trafficTargets_max);
+}
+
+
 auto GlobalSettings::mapBearingPolicy() const -> GlobalSettings::MapBearingPolicy
 {
     auto intVal = settings.value(QStringLiteral("Map/bearingPolicy"), 0).toInt();
@@ -282,3 +296,27 @@ void GlobalSettings::setShowAltitudeAGL(bool newShowAltitudeAGL)
     settings.setValue(QStringLiteral("showAltitudeAGL"), newShowAltitudeAGL);
     emit showAltitudeAGLChanged();
 }
+
+
+void GlobalSettings::setTileCacheSize(Units::ByteSize newTileCacheSize)
+{
+    auto size = qBound(tileCacheSize_min, static_cast<size_t>(newTileCacheSize), tileCacheSize_max);
+    if (size == tileCacheSize())
+    {
+        return;
+    }
+    settings.setValue(QStringLiteral("Map/tileCacheSize"), static_cast<qulonglong>(size));
+    emit tileCacheSizeChanged();
+}
+
+
+void GlobalSettings::setTrafficTargets(int newTrafficTargets)
+{
+    auto targets = qBound(trafficTargets_min, newTrafficTargets, trafficTargets_max);
+    if (targets == trafficTargets())
+    {
+        return;
+    }
+    settings.setValue(QStringLiteral("Traffic/targets"), targets);
+    emit trafficTargetsChanged();
+}
@@ -176,6 +176,28 @@ public:
     /*! \brief Use traffic data receiver for positioning */
     Q_PROPERTY(bool positioningByTrafficDataReceiver READ positioningByTrafficDataReceiver WRITE setPositioningByTrafficDataReceiver NOTIFY positioningByTrafficDataReceiverChanged)
 
+    /*! \brief Memory budget of the tile cache, in bytes
+     *
+     *  The local tile server keeps recently requested map tiles in memory. This
+     *  property holds the maximal size of the cache. The value lies in the
+     *  range [tileCacheSize_min, tileCacheSize_max].
+     */
+    Q_PROPERTY(Units::ByteSize tileCacheSize READ tileCacheSize WRITE setTileCacheSize NOTIFY tileCacheSizeChanged)
+
+    /*! \brief Number of traffic targets tracked and shown on the map
+     *
+     *  The traffic data provider keeps this many of the most relevant traffic
+     *  targets. The value lies in the range [trafficTargets_min,
+     *  trafficTargets_max].
+     */
+    Q_PROPERTY(int trafficTargets READ trafficTargets WRITE setTrafficTargets NOTIFY trafficTargetsChanged)
+
+    /*! \brief Minimum acceptable value for property trafficTargets */
+    Q_PROPERTY(int trafficTargets_min MEMBER trafficTargets_min CONSTANT)
+
+    /*! \brief Maximum acceptable value for property trafficTargets */
+    Q_PROPERTY(int trafficTargets_max MEMBER trafficTargets_max CONSTANT)
+
 
     //
     // Getter Methods
@@ -289,6 +311,18 @@ public:
      */
     [[nodiscard]] auto showAltitudeAGL() const -> bool { return settings.value(QStringLiteral("showAltitudeAGL"), false).toBool(); }
 
+    /*! \brief Getter function for property of the same name
+     *
+     * @returns Property tileCacheSize
+     */
+    [[nodiscard]] auto tileCacheSize() const -> Units::ByteSize;
+
+    /*! \brief Getter function for property of the same name
+     *
+     * @returns Property trafficTargets
+     */
+    [[nodiscard]] auto trafficTargets() const -> int;
+
 
     //
     // Setter Methods
@@ -396,6 +430,24 @@ public:
      */
     void setShowAltitudeAGL(bool newShowAltitudeAGL);
 
+    /*! \brief Setter function for property of the same name
+     *
+     *  The value is bounded to the range [tileCacheSize_min,
+     *  tileCacheSize_max].
+     *
+     * @param newTileCacheSize Property tileCacheSize
+     */
+    void setTileCacheSize(Units::ByteSize newTileCacheSize);
+
+    /*! \brief Setter function for property of the same name
+     *
+     *  The value is bounded to the range [trafficTargets_min,
+     *  trafficTargets_max].
+     *
+     * @param newTrafficTargets Property trafficTargets
+     */
+    void setTrafficTargets(int newTrafficTargets);
+
 
     //
     // Constants
@@ -403,6 +455,12 @@ public:
 
     static constexpr Units::Distance airspaceAltitudeLimit_min = Units::Distance::fromFT(3000);
     static constexpr Units::Distance airspaceAltitudeLimit_max = Units::Distance::fromFT(15000);
+    static constexpr size_t tileCacheSize_min = 4*1024*1024;
+    static constexpr size_t tileCacheSize_default = 64*1024*1024;
+    static constexpr size_t tileCacheSize_max = 512*1024*1024;
+    static constexpr int trafficTargets_min = 5;
+    static constexpr int trafficTargets_default = 20;
+    static constexpr int trafficTargets_max = 200;
 
 signals:
     /*! \brief Notifier signal */
@@ -453,6 +511,12 @@ signals:
     /*! \brief Notifier signal */
     void showAltitudeAGLChanged();
 
+    /*! \brief Notifier signal */
+    void tileCacheSizeChanged();
+
+    /*! \brief Notifier signal */
+    void trafficTargetsChanged();
+
 private:
     Q_DISABLE_COPY_MOVE(GlobalSettings)
 
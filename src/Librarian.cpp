@@ -25,6 +25,8 @@
 #include <QStandardPaths>
 #include <QSysInfo>
 #include <QtGlobal>
+#include <algorithm>
+#include <array>
 
 
 Librarian::Librarian(QObject *parent) : QObject(parent)
@@ -384,12 +386,72 @@ auto Librarian::permissiveFilter(const QStringList &inputStrings, const QString
 
 auto Librarian::simplifySpecialChars(const QString &string) -> QString
 {
-    QString cacheString = simplifySpecialChars_cache[string];
-    if (!cacheString.isEmpty())
     {
-        return cacheString;
+        QMutexLocker locker(&simplifySpecialChars_mutex);
+        auto* cacheString = simplifySpecialChars_cache.object(string);
+        if (cacheString != nullptr)
+        {
+            simplifySpecialChars_hits++;
+            return *cacheString;
+        }
+        simplifySpecialChars_misses++;
     }
 
-    QString normalizedString = string.normalized(QString::NormalizationForm_KD);
-    return normalizedString.remove(specialChars);
+    auto result = simplifySpecialCharsUncached(string);
+
+    QMutexLocker locker(&simplifySpecialChars_mutex);
+    simplifySpecialChars_cache.insert(string, new QString(result));
+    return result;
+}
+
+
+auto Librarian::simplifySpecialCharsUncached(const QString &string) -> QString
+{
+    // Table of ASCII characters that are kept
+    static constexpr auto isKept = []() {
+        std::array<bool, 128> table {};
+        for(int c='a'; c<='z'; c++)
+        {
+            table[c] = true;
+        }
+        for(int c='A'; c<='Z'; c++)
+        {
+            table[c] = true;
+        }
+        for(int c='0'; c<='9'; c++)
+        {
+            table[c] = true;
+        }
+        return table;
+    }();
+
+    // Unicode normalization is expensive, and does not change ASCII strings
+    bool isASCII = std::all_of(string.cbegin(), string.cend(), [](QChar character) { return character.unicode() < 128; });
+    auto normalizedString = isASCII ? string : string.normalized(QString::NormalizationForm_KD);
+
+    QString result;
+    result.reserve(normalizedString.size());
+    for(auto character : normalizedString)
+    {
+        auto unicode = character.unicode();
+        if ((unicode < 128) && isKept[unicode])
+        {
+            result.append(character);
+        }
+    }
+    return result;
+}
+
+
+auto Librarian::simplifySpecialCharsCacheHits() const -> quint64
+{
+    QMutexLocker locker(&simplifySpecialChars_mutex);
+    return simplifySpecialChars_hits;
+}
+
+
+auto Librarian::simplifySpecialCharsCacheMisses() const -> quint64
+{
+    QMutexLocker locker(&simplifySpecialChars_mutex);
+    return simplifySpecialChars_misses;
 }
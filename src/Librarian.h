@@ -20,9 +20,10 @@
 
 #pragma once
 
+#include <QCache>
 #include <QDir>
+#include <QMutex>
 #include <QQmlEngine>
-#include <QRegularExpression>
 #include <QSettings>
 
 #include "GlobalObject.h"
@@ -202,7 +203,8 @@ public:
      *
      * This helper method simplifies a unicode string, by transforming it to
      * QString::NormalizationForm_KD and then removing all 'special' character.
-     * The results are cached for better performance.
+     * The results are cached for better performance. This method is
+     * thread-safe.
      *
      * @param string Input string
      *
@@ -210,11 +212,41 @@ public:
      */
     auto simplifySpecialChars(const QString &string) -> QString;
 
+    /*! \brief Simplifies string by transforming and removing special characters
+     *
+     * This method does the same as simplifySpecialChars, but does not use the
+     * cache. It is meant for callers that simplify large numbers of strings
+     * once, and would only flush the cache.  Strings that consist of ASCII
+     * characters only are handled by a fast path that avoids unicode
+     * normalization.
+     *
+     * @param string Input string
+     *
+     * @return Simplified string
+     */
+    static auto simplifySpecialCharsUncached(const QString &string) -> QString;
+
+    /*! \brief Number of cache hits in simplifySpecialChars
+     *
+     * @returns Number of calls to simplifySpecialChars that were answered
+     * from the cache
+     */
+    [[nodiscard]] auto simplifySpecialCharsCacheHits() const -> quint64;
+
+    /*! \brief Number of cache misses in simplifySpecialChars
+     *
+     * @returns Number of calls to simplifySpecialChars that were not
+     * answered from the cache
+     */
+    [[nodiscard]] auto simplifySpecialCharsCacheMisses() const -> quint64;
+
 private:
     Q_DISABLE_COPY_MOVE(Librarian)
 
-    // Caches used to speed up the method simplifySpecialChars
-    QRegularExpression specialChars {QStringLiteral("[^a-zA-Z0-9]")};
-    QHash<QString, QString> simplifySpecialChars_cache;
-
+    // Cache used to speed up the method simplifySpecialChars, together with
+    // hit/miss counters. All three members are protected by the mutex.
+    mutable QMutex simplifySpecialChars_mutex;
+    QCache<QString, QString> simplifySpecialChars_cache {10000};
+    quint64 simplifySpecialChars_hits {0};
+    quint64 simplifySpecialChars_misses {0};
 };
@@ -19,13 +19,13 @@
  ***************************************************************************/
 
 #include <QDir>
-#include <QJsonDocument>
 #include <QJsonObject>
 #include <QLockFile>
 
 #include "Downloadable_SingleFile.h"
 #include "GlobalObject.h"
 #include "GlobalSettings.h"
+#include "geomaps/GeoJSONReader.h"
 #include "geomaps/MBTILES.h"
 
 
@@ -122,10 +122,11 @@ auto DataManagement::Downloadable_SingleFile::description() -> QString
         lockFile.lock();
         QFile file(m_fileName);
         file.open(QIODevice::ReadOnly);
-        auto document = QJsonDocument::fromJson(file.readAll());
+        GeoMaps::GeoJSONReader reader(&file);
+        reader.readToEnd();
         file.close();
         lockFile.unlock();
-        QString concatInfoString = document.object()[QStringLiteral("info")].toString();
+        QString concatInfoString = reader.topLevelValues()[QStringLiteral("info")].toString();
         if (!concatInfoString.isEmpty())
         {
             result += "<p>" + tr("The map data was compiled from the following sources.") + "</p><ul>";
@@ -165,3 +165,29 @@ auto GeoMaps::qHash(const GeoMaps::Airspace& A) -> size_t
     result += qHash(A.polygon());
     return result;
 }
+
+
+QDataStream& GeoMaps::operator<<(QDataStream& stream, const GeoMaps::Airspace& airspace)
+{
+    stream << airspace.m_name;
+    stream << airspace.m_CAT;
+    stream << airspace.m_upperBound;
+    stream << airspace.m_lowerBound;
+    stream << airspace.m_polygon.perimeter();
+
+    return stream;
+}
+
+
+QDataStream& GeoMaps::operator>>(QDataStream& stream, GeoMaps::Airspace& airspace)
+{
+    stream >> airspace.m_name;
+    stream >> airspace.m_CAT;
+    stream >> airspace.m_upperBound;
+    stream >> airspace.m_lowerBound;
+    QList<QGeoCoordinate> perimeter;
+    stream >> perimeter;
+    airspace.m_polygon = QGeoPolygon(perimeter);
+
+    return stream;
+}
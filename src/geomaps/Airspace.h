@@ -20,6 +20,7 @@
 
 #pragma once
 
+#include <QDataStream>
 #include <QGeoPolygon>
 #include <QJsonObject>
 
@@ -35,6 +36,9 @@ class Airspace {
     /*! \brief Comparison */
     friend auto operator==(const GeoMaps::Airspace&, const GeoMaps::Airspace&) -> bool;
 
+    friend QDataStream& operator<<(QDataStream& stream, const GeoMaps::Airspace& airspace);
+    friend QDataStream& operator>>(QDataStream& stream, GeoMaps::Airspace& airspace);
+
 public:
     /*! \brief Constructs an invalid airspace */
     Airspace() = default;
@@ -174,6 +178,18 @@ auto operator==(const GeoMaps::Airspace&, const GeoMaps::Airspace&) -> bool;
  */
 auto qHash(const GeoMaps::Airspace& as) -> size_t;
 
+/*! \brief Serialization
+ *
+ *  There is no checks for errors of any kind.
+ */
+QDataStream& operator<<(QDataStream& stream, const GeoMaps::Airspace& airspace);
+
+/*! \brief Deserialization
+ *
+ *  There is no checks for errors of any kind.
+ */
+QDataStream& operator>>(QDataStream& stream, GeoMaps::Airspace& airspace);
+
 } // namespace GeoMaps
 
 
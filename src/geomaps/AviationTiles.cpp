@@ -0,0 +1,741 @@
+/***************************************************************************
+ *   Copyright (C) 2023 by Stefan Kebekus                                  *
+ *   stefan.kebekus@gmail.com                                              *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 3 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, write to the                         *
+ *   Free Software Foundation, Inc.,                                       *
+ *   59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.             *
+ ***************************************************************************/
+
+
+#include <QJsonArray>
+#include <QSet>
+#include <QtEndian>
+#include <QtMath>
+#include <algorithm>
+#include <cstring>
+
+#include "geomaps/AviationTiles.h"
+
+
+//
+// Helper functions for the projection, for clipping and for writing protobuf
+// messages
+//
+
+namespace {
+
+// Projects a GeoJSON position to Web Mercator coordinates in the unit square
+auto project(const QJsonValue& position) -> QPointF
+{
+    auto array = position.toArray();
+    auto longitude = array[0].toDouble();
+    auto latitude = qBound(-85.0511287798, array[1].toDouble(), 85.0511287798);
+    return {(longitude+180.0)/360.0, (1.0 - asinh(tan(qDegreesToRadians(latitude)))/M_PI)/2.0};
+}
+
+// Projects a GeoJSON array of positions. If isRing is true, the closing
+// position (which in GeoJSON equals the first one) is removed.
+auto project(const QJsonArray& positions, bool isRing) -> QVector<QPointF>
+{
+    QVector<QPointF> result;
+    result.reserve(positions.size());
+    for(const auto& position : positions)
+    {
+        result.append(project(position));
+    }
+    if (isRing && (result.size() > 1) && (result.first() == result.last()))
+    {
+        result.removeLast();
+    }
+    return result;
+}
+
+// Clips a polygon ring to the square [low, high]x[low, high], using the
+// Sutherland-Hodgman algorithm
+auto clipRing(const QVector<QPointF>& ring, double low, double high) -> QVector<QPointF>
+{
+    QVector<QPointF> output = ring;
+    for(int edge=0; edge<4; edge++)
+    {
+        if (output.isEmpty())
+        {
+            break;
+        }
+        auto inside = [&](const QPointF& point) {
+            switch(edge)
+            {
+            case 0:
+                return point.x() >= low;
+            case 1:
+                return point.x() <= high;
+            case 2:
+                return point.y() >= low;
+            default:
+                return point.y() <= high;
+            }
+        };
+        auto intersection = [&](const QPointF& a, const QPointF& b) -> QPointF {
+            switch(edge)
+            {
+            case 0:
+                return {low, a.y() + (low-a.x())/(b.x()-a.x())*(b.y()-a.y())};
+            case 1:
+                return {high, a.y() + (high-a.x())/(b.x()-a.x())*(b.y()-a.y())};
+            case 2:
+                return {a.x() + (low-a.y())/(b.y()-a.y())*(b.x()-a.x()), low};
+            default:
+                return {a.x() + (high-a.y())/(b.y()-a.y())*(b.x()-a.x()), high};
+            }
+        };
+
+        auto input = output;
+        output.clear();
+        auto previous = input.last();
+        for(const auto& current : input)
+        {
+            if (inside(current))
+            {
+                if (!inside(previous))
+                {
+                    output.append(intersection(previous, current));
+                }
+                output.append(current);
+            }
+            else if (inside(previous))
+            {
+                output.append(intersection(previous, current));
+            }
+            previous = current;
+        }
+    }
+    return output;
+}
+
+// Clips a line string to the square [low, high]x[low, high], using the
+// Liang-Barsky algorithm on every segment. The result can consist of several
+// line strings.
+auto clipLine(const QVector<QPointF>& line, double low, double high) -> QVector<QVector<QPointF>>
+{
+    QVector<QVector<QPointF>> result;
+    QVector<QPointF> current;
+    for(qsizetype i=1; i<line.size(); i++)
+    {
+        auto a = line[i-1];
+        auto b = line[i];
+        auto dx = b.x()-a.x();
+        auto dy = b.y()-a.y();
+
+        double t0 = 0.0;
+        double t1 = 1.0;
+        auto clip = [&](double p, double q) {
+            if (p == 0.0)
+            {
+                return q >= 0.0;
+            }
+            auto r = q/p;
+            if (p < 0.0)
+            {
+                if (r > t1)
+                {
+                    return false;
+                }
+                t0 = qMax(t0, r);
+            }
+            else
+            {
+                if (r < t0)
+                {
+                    return false;
+                }
+                t1 = qMin(t1, r);
+            }
+            return true;
+        };
+        if (!clip(-dx, a.x()-low) || !clip(dx, high-a.x()) || !clip(-dy, a.y()-low) || !clip(dy, high-a.y()))
+        {
+            if (current.size() >= 2)
+            {
+                result.append(current);
+            }
+            current.clear();
+            continue;
+        }
+
+        if (current.isEmpty() || (t0 > 0.0))
+        {
+            if (current.size() >= 2)
+            {
+                result.append(current);
+            }
+            current = {a + t0*(b-a)};
+        }
+        current.append(a + t1*(b-a));
+        if (t1 < 1.0)
+        {
+            result.append(current);
+            current.clear();
+        }
+    }
+    if (current.size() >= 2)
+    {
+        result.append(current);
+    }
+    return result;
+}
+
+// Rounds points to integer tile coordinates and removes consecutive
+// duplicates
+auto toTileCoordinates(const QVector<QPointF>& points) -> QVector<QPoint>
+{
+    QVector<QPoint> result;
+    result.reserve(points.size());
+    for(const auto& point : points)
+    {
+        QPoint rounded(qRound(point.x()), qRound(point.y()));
+        if (result.isEmpty() || (result.last() != rounded))
+        {
+            result.append(rounded);
+        }
+    }
+    return result;
+}
+
+// Protobuf encoding, see https://protobuf.dev/programming-guides/encoding/
+void writeVarint(QByteArray& out, quint64 value)
+{
+    while (value >= 0x80)
+    {
+        out.append(static_cast<char>((value & 0x7F) | 0x80));
+        value >>= 7;
+    }
+    out.append(static_cast<char>(value));
+}
+
+void writeKey(QByteArray& out, quint32 field, quint32 wireType)
+{
+    writeVarint(out, (field << 3) | wireType);
+}
+
+void writeBytes(QByteArray& out, quint32 field, const QByteArray& bytes)
+{
+    writeKey(out, field, 2);
+    writeVarint(out, bytes.size());
+    out.append(bytes);
+}
+
+void writePacked(QByteArray& out, quint32 field, const QVector<quint32>& values)
+{
+    QByteArray packed;
+    for(auto value : values)
+    {
+        writeVarint(packed, value);
+    }
+    writeBytes(out, field, packed);
+}
+
+auto zigzag(qint32 value) -> quint32
+{
+    return (static_cast<quint32>(value) << 1) ^ static_cast<quint32>(value >> 31);
+}
+
+// Vector tile geometry commands
+enum Command : quint32 {
+    MoveTo = 1,
+    LineTo = 2,
+    ClosePath = 7
+};
+
+// Helper class that generates the geometry of a vector tile feature. The
+// cursor position is shared between all parts of the geometry.
+class GeometryWriter
+{
+public:
+    void moveTo(const QVector<QPoint>& points)
+    {
+        command(MoveTo, points.size());
+        for(const auto& point : points)
+        {
+            parameter(point);
+        }
+    }
+
+    void lineString(const QVector<QPoint>& points)
+    {
+        moveTo({points[0]});
+        command(LineTo, points.size()-1);
+        for(qsizetype i=1; i<points.size(); i++)
+        {
+            parameter(points[i]);
+        }
+    }
+
+    void ring(const QVector<QPoint>& points)
+    {
+        lineString(points);
+        command(ClosePath, 1);
+    }
+
+    QVector<quint32> geometry;
+
+private:
+    void command(Command id, qsizetype count)
+    {
+        geometry.append(static_cast<quint32>(id) | (static_cast<quint32>(count) << 3));
+    }
+
+    void parameter(const QPoint& point)
+    {
+        geometry.append(zigzag(point.x()-m_cursor.x()));
+        geometry.append(zigzag(point.y()-m_cursor.y()));
+        m_cursor = point;
+    }
+
+    QPoint m_cursor {0, 0};
+};
+
+// Twice the signed area of a ring, using the surveyor's formula
+auto doubleArea(const QVector<QPoint>& ring) -> qint64
+{
+    qint64 result = 0;
+    for(qsizetype i=0; i<ring.size(); i++)
+    {
+        const auto& a = ring[i];
+        const auto& b = ring[(i+1)%ring.size()];
+        result += static_cast<qint64>(a.x())*b.y() - static_cast<qint64>(b.x())*a.y();
+    }
+    return result;
+}
+
+// Encodes a JSON value as a vector tile value message. Returns an empty array
+// for values that cannot be represented.
+auto encodeValue(const QJsonValue& value) -> QByteArray
+{
+    QByteArray result;
+    switch(value.type())
+    {
+    case QJsonValue::String:
+        writeBytes(result, 1, value.toString().toUtf8());
+        break;
+    case QJsonValue::Bool:
+        writeKey(result, 7, 0);
+        writeVarint(result, value.toBool() ? 1 : 0);
+        break;
+    case QJsonValue::Double:
+    {
+        auto number = value.toDouble();
+        if ((number == std::floor(number)) && (qAbs(number) < 9007199254740992.0))
+        {
+            auto integer = static_cast<qint64>(number);
+            writeKey(result, 6, 0);
+            writeVarint(result, (static_cast<quint64>(integer) << 1) ^ static_cast<quint64>(integer >> 63));
+            break;
+        }
+        quint64 bits = 0;
+        std::memcpy(&bits, &number, sizeof(bits));
+        writeKey(result, 3, 1);
+        char bytes[8];
+        qToLittleEndian(bits, bytes);
+        result.append(bytes, 8);
+        break;
+    }
+    default:
+        break;
+    }
+    return result;
+}
+
+} // namespace
+
+
+//
+// Feature
+//
+
+auto GeoMaps::AviationTiles::Feature::fromGeoJSON(const QJsonObject& geoJSONObject) -> Feature
+{
+    Feature result;
+
+    auto geometry = geoJSONObject[QStringLiteral("geometry")].toObject();
+    auto geometryType = geometry[QStringLiteral("type")].toString();
+    auto coordinates = geometry[QStringLiteral("coordinates")].toArray();
+
+    auto addPolygon = [&result](const QJsonArray& rings) {
+        bool isHole = false;
+        for(const auto& ring : rings)
+        {
+            result.parts.append(Part{project(ring.toArray(), true), isHole});
+            isHole = true;
+        }
+    };
+
+    if (geometryType == u"Point")
+    {
+        result.type = Type::Point;
+        result.parts.append(Part{{project(QJsonValue(coordinates))}, false});
+    }
+    else if (geometryType == u"MultiPoint")
+    {
+        result.type = Type::Point;
+        result.parts.append(Part{project(coordinates, false), false});
+    }
+    else if (geometryType == u"LineString")
+    {
+        result.type = Type::LineString;
+        result.parts.append(Part{project(coordinates, false), false});
+    }
+    else if (geometryType == u"MultiLineString")
+    {
+        result.type = Type::LineString;
+        for(const auto& line : coordinates)
+        {
+            result.parts.append(Part{project(line.toArray(), false), false});
+        }
+    }
+    else if (geometryType == u"Polygon")
+    {
+        result.type = Type::Polygon;
+        addPolygon(coordinates);
+    }
+    else if (geometryType == u"MultiPolygon")
+    {
+        result.type = Type::Polygon;
+        for(const auto& polygon : coordinates)
+        {
+            addPolygon(polygon.toArray());
+        }
+    }
+    else
+    {
+        return {};
+    }
+
+    result.properties = geoJSONObject[QStringLiteral("properties")].toObject();
+    return result;
+}
+
+
+auto GeoMaps::AviationTiles::Feature::boundingBox() const -> RTree::Box
+{
+    RTree::Box result {1.0, 1.0, 0.0, 0.0};
+    for(const auto& part : parts)
+    {
+        for(const auto& point : part.points)
+        {
+            result.minX = qMin(result.minX, point.x());
+            result.minY = qMin(result.minY, point.y());
+            result.maxX = qMax(result.maxX, point.x());
+            result.maxY = qMax(result.maxY, point.y());
+        }
+    }
+    return result;
+}
+
+
+//
+// AviationTiles
+//
+
+GeoMaps::AviationTiles::AviationTiles(const QVector<QByteArray>& keys, const QVector<Feature>& features)
+    : m_keys(keys), m_features(features)
+{
+    m_boxes.reserve(m_features.size());
+    for(const auto& feature : m_features)
+    {
+        m_boxes.append(feature.boundingBox());
+    }
+    m_index = RTree(m_boxes);
+}
+
+
+void GeoMaps::AviationTiles::inheritCache(AviationTiles& previous)
+{
+    // Find bounding boxes of all features that have been added or removed
+    QSet<QByteArray> previousKeys(previous.m_keys.cbegin(), previous.m_keys.cend());
+    QSet<QByteArray> currentKeys(m_keys.cbegin(), m_keys.cend());
+    QVector<RTree::Box> changedBoxes;
+    for(qsizetype i=0; i<m_keys.size(); i++)
+    {
+        if (!previousKeys.contains(m_keys[i]))
+        {
+            changedBoxes.append(m_boxes[i]);
+        }
+    }
+    for(qsizetype i=0; i<previous.m_keys.size(); i++)
+    {
+        if (!currentKeys.contains(previous.m_keys[i]))
+        {
+            changedBoxes.append(previous.m_boxes[i]);
+        }
+    }
+    RTree changedIndex(changedBoxes);
+
+    // Copy all tiles that do not intersect any of these boxes
+    QMutexLocker previousLocker(&previous.m_cacheMutex);
+    QMutexLocker locker(&m_cacheMutex);
+    foreach(auto key, previous.m_cache.keys())
+    {
+        auto zoom = static_cast<int>(key >> 48);
+        auto x = static_cast<int>((key >> 24) & 0xFFFFFF);
+        auto y = static_cast<int>(key & 0xFFFFFF);
+        if (!changedIndex.search(tileBox(zoom, x, y)).isEmpty())
+        {
+            continue;
+        }
+        auto* data = previous.m_cache.object(key);
+        if (data != nullptr)
+        {
+            m_cache.insert(key, new QByteArray(*data), qMax(qsizetype(1), data->size()));
+        }
+    }
+}
+
+
+auto GeoMaps::AviationTiles::tile(int zoom, int x, int y) -> QByteArray
+{
+    if ((zoom < minZoom) || (zoom > maxZoom))
+    {
+        return {};
+    }
+    if ((x < 0) || (x >= (1<<zoom)) || (y < 0) || (y >= (1<<zoom)))
+    {
+        return {};
+    }
+
+    auto key = cacheKey(zoom, x, y);
+    {
+        QMutexLocker locker(&m_cacheMutex);
+        auto* data = m_cache.object(key);
+        if (data != nullptr)
+        {
+            return *data;
+        }
+    }
+
+    auto data = encode(zoom, x, y);
+    QMutexLocker locker(&m_cacheMutex);
+    m_cache.insert(key, new QByteArray(data), qMax(qsizetype(1), data.size()));
+    return data;
+}
+
+
+auto GeoMaps::AviationTiles::tileBox(int zoom, int x, int y) -> RTree::Box
+{
+    auto size = 1.0/(1<<zoom);
+    auto margin = size*buffer/extent;
+    return {x*size-margin, y*size-margin, (x+1)*size+margin, (y+1)*size+margin};
+}
+
+
+auto GeoMaps::AviationTiles::encode(int zoom, int x, int y) const -> QByteArray
+{
+    auto candidates = m_index.search(tileBox(zoom, x, y));
+    if (candidates.isEmpty())
+    {
+        return {};
+    }
+
+    // Transformation from Web Mercator to tile coordinates
+    const double scale = static_cast<double>(1<<zoom)*extent;
+    const QPointF origin(static_cast<double>(x)*extent, static_cast<double>(y)*extent);
+    auto toTile = [&](const QVector<QPointF>& points) {
+        QVector<QPointF> result;
+        result.reserve(points.size());
+        for(const auto& point : points)
+        {
+            result.append(point*scale - origin);
+        }
+        return result;
+    };
+    const double low = -buffer;
+    const double high = extent+buffer;
+
+    QByteArray layer;
+    writeKey(layer, 15, 0);
+    writeVarint(layer, 2);
+    writeBytes(layer, 1, layerName().toUtf8());
+    writeKey(layer, 5, 0);
+    writeVarint(layer, extent);
+
+    QHash<QString, quint32> keyIndices;
+    QHash<QByteArray, quint32> valueIndices;
+    QByteArray keysAndValues;
+    bool hasFeatures = false;
+
+    for(auto index : candidates)
+    {
+        const auto& feature = m_features[index];
+
+        // Generate geometry
+        GeometryWriter writer;
+        switch(feature.type)
+        {
+        case Feature::Type::Point:
+        {
+            QVector<QPoint> points;
+            for(const auto& part : feature.parts)
+            {
+                for(const auto& point : toTile(part.points))
+                {
+                    if ((point.x() >= low) && (point.x() <= high) && (point.y() >= low) && (point.y() <= high))
+                    {
+                        points.append(QPoint(qRound(point.x()), qRound(point.y())));
+                    }
+                }
+            }
+            if (!points.isEmpty())
+            {
+                writer.moveTo(points);
+            }
+            break;
+        }
+        case Feature::Type::LineString:
+            for(const auto& part : feature.parts)
+            {
+                foreach(auto line, clipLine(toTile(part.points), low, high))
+                {
+                    auto points = toTileCoordinates(line);
+                    if (points.size() >= 2)
+                    {
+                        writer.lineString(points);
+                    }
+                }
+            }
+            break;
+        case Feature::Type::Polygon:
+        {
+            bool skipHoles = false;
+            for(const auto& part : feature.parts)
+            {
+                if (part.isHole && skipHoles)
+                {
+                    continue;
+                }
+                auto points = toTileCoordinates(clipRing(toTile(part.points), low, high));
+                if ((points.size() > 1) && (points.first() == points.last()))
+                {
+                    points.removeLast();
+                }
+                auto area = (points.size() >= 3) ? doubleArea(points) : 0;
+                if (area == 0)
+                {
+                    if (!part.isHole)
+                    {
+                        skipHoles = true;
+                    }
+                    continue;
+                }
+                if (!part.isHole)
+                {
+                    skipHoles = false;
+                }
+
+                // Exterior rings must have positive area, interior rings
+                // negative area
+                if ((area > 0) == part.isHole)
+                {
+                    std::reverse(points.begin(), points.end());
+                }
+                writer.ring(points);
+            }
+            break;
+        }
+        case Feature::Type::Unknown:
+            break;
+        }
+        if (writer.geometry.isEmpty())
+        {
+            continue;
+        }
+
+        // Generate tags
+        QVector<quint32> tags;
+        for(auto it = feature.properties.constBegin(); it != feature.properties.constEnd(); it++)
+        {
+            auto value = encodeValue(it.value());
+            if (value.isEmpty())
+            {
+                continue;
+            }
+            if (!keyIndices.contains(it.key()))
+            {
+                keyIndices.insert(it.key(), static_cast<quint32>(keyIndices.size()));
+                writeBytes(keysAndValues, 3, it.key().toUtf8());
+            }
+            if (!valueIndices.contains(value))
+            {
+                valueIndices.insert(value, static_cast<quint32>(valueIndices.size()));
+                writeBytes(keysAndValues, 4, value);
+            }
+            tags << keyIndices.value(it.key()) << valueIndices.value(value);
+        }
+
+        QByteArray featureMessage;
+        writePacked(featureMessage, 2, tags);
+        writeKey(featureMessage, 3, 0);
+        writeVarint(featureMessage, static_cast<quint32>(feature.type));
+        writePacked(featureMessage, 4, writer.geometry);
+        writeBytes(layer, 2, featureMessage);
+        hasFeatures = true;
+    }
+    if (!hasFeatures)
+    {
+        return {};
+    }
+    layer += keysAndValues;
+
+    QByteArray result;
+    writeBytes(result, 3, layer);
+    return result;
+}
+
+
+//
+// Serialization
+//
+
+QDataStream& GeoMaps::operator<<(QDataStream& stream, const GeoMaps::AviationTiles::Feature& feature)
+{
+    stream << static_cast<quint8>(feature.type);
+    stream << static_cast<qint64>(feature.parts.size());
+    for(const auto& part : feature.parts)
+    {
+        stream << part.points;
+        stream << part.isHole;
+    }
+    stream << feature.properties;
+
+    return stream;
+}
+
+
+QDataStream& GeoMaps::operator>>(QDataStream& stream, GeoMaps::AviationTiles::Feature& feature)
+{
+    quint8 type = 0;
+    stream >> type;
+    feature.type = static_cast<GeoMaps::AviationTiles::Feature::Type>(type);
+    qint64 numParts = 0;
+    stream >> numParts;
+    feature.parts.clear();
+    for(qint64 i=0; (i<numParts) && (stream.status() == QDataStream::Ok); i++)
+    {
+        GeoMaps::AviationTiles::Feature::Part part;
+        stream >> part.points;
+        stream >> part.isHole;
+        feature.parts.append(part);
+    }
+    stream >> feature.properties;
+
+    return stream;
+}
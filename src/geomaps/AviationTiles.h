@@ -0,0 +1,207 @@
+/***************************************************************************
+ *   Copyright (C) 2023 by Stefan Kebekus                                  *
+ *   stefan.kebekus@gmail.com                                              *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 3 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, write to the                         *
+ *   Free Software Foundation, Inc.,                                       *
+ *   59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.             *
+ ***************************************************************************/
+
+
+#pragma once
+
+#include <QCache>
+#include <QDataStream>
+#include <QJsonObject>
+#include <QMutex>
+#include <QPointF>
+#include <QVector>
+
+#include "geomaps/RTree.h"
+
+namespace GeoMaps {
+
+/*! \brief Aviation data, cut into vector tiles
+ *
+ *  This class holds the geometry and properties of the aviation map features
+ *  in Web Mercator coordinates, and encodes them on request as vector tiles,
+ *  following the Mapbox Vector Tile Specification 2.1
+ *  (https://github.com/mapbox/vector-tile-spec/tree/master/2.1). All features
+ *  are put into one layer, whose name is given by layerName(). Geometries are
+ *  clipped to the tile, with a small buffer. Encoded tiles are cached.
+ *
+ *  The feature data is immutable. The methods of this class are thread-safe.
+ */
+
+class AviationTiles {
+
+public:
+    /*! \brief Feature, with coordinates in Web Mercator projection
+     *
+     *  Coordinates are projected to the unit square, where (0,0) is the
+     *  north-west corner and (1,1) is the south-east corner of the map.
+     */
+    struct Feature {
+        /*! \brief Geometry types, numbered as in the vector tile specification */
+        enum class Type : quint8 {
+            Unknown = 0,
+            Point = 1,
+            LineString = 2,
+            Polygon = 3
+        };
+
+        /*! \brief Part of the geometry
+         *
+         *  Depending on the type of the feature, this is a list of points, a
+         *  line string or a polygon ring.
+         */
+        struct Part {
+            /*! \brief Points in Web Mercator coordinates */
+            QVector<QPointF> points;
+
+            /*! \brief For polygons, true if the ring is an interior ring */
+            bool isHole {false};
+        };
+
+        /*! \brief Construct a feature from GeoJSON
+         *
+         *  Points, line strings and polygons, as well as their "Multi"
+         *  versions are supported. For other geometries, an invalid feature
+         *  is returned.
+         *
+         *  @param geoJSONObject GeoJSON object that describes the feature
+         *
+         *  @returns Feature
+         */
+        static auto fromGeoJSON(const QJsonObject& geoJSONObject) -> Feature;
+
+        /*! \brief Validity
+         *
+         *  @returns True if the feature has a geometry that can be drawn
+         */
+        [[nodiscard]] auto isValid() const -> bool
+        {
+            return (type != Type::Unknown) && !parts.isEmpty();
+        }
+
+        /*! \brief Bounding box in Web Mercator coordinates
+         *
+         *  @returns Bounding box of all points of the feature
+         */
+        [[nodiscard]] auto boundingBox() const -> RTree::Box;
+
+        /*! \brief Geometry type */
+        Type type {Type::Unknown};
+
+        /*! \brief Parts of the geometry */
+        QVector<Part> parts;
+
+        /*! \brief Properties, as found in the GeoJSON */
+        QJsonObject properties;
+    };
+
+    /*! \brief Constructs an empty tile set */
+    AviationTiles() = default;
+
+    /*! \brief Constructs a tile set
+     *
+     *  @param keys Unique keys for the features, used to find out which
+     *  features have changed between two tile sets. Typically, these are
+     *  serializations of the GeoJSON objects.
+     *
+     *  @param features Features, in the same order as the keys.
+     */
+    AviationTiles(const QVector<QByteArray>& keys, const QVector<Feature>& features);
+
+    /*! \brief Take over cached tiles from an older tile set
+     *
+     *  This method copies all cached tiles from the older tile set that are not
+     *  affected by any feature that was added or removed.
+     *
+     *  @param previous Older tile set
+     */
+    void inheritCache(AviationTiles& previous);
+
+    /*! \brief Name of the layer in the vector tiles
+     *
+     *  @returns Layer name
+     */
+    static auto layerName() -> QString
+    {
+        return QStringLiteral("aviation");
+    }
+
+    /*! \brief Minimal zoom level for which tiles are generated */
+    static constexpr int minZoom = 0;
+
+    /*! \brief Maximal zoom level for which tiles are generated */
+    static constexpr int maxZoom = 14;
+
+    /*! \brief Encoded vector tile
+     *
+     *  @param zoom Zoom level
+     *
+     *  @param x Tile column
+     *
+     *  @param y Tile row, counted from the north, as in the XYZ scheme
+     *
+     *  @returns Uncompressed vector tile in protobuf format, or an empty array
+     *  if the tile does not exist or contains no features
+     */
+    [[nodiscard]] auto tile(int zoom, int x, int y) -> QByteArray;
+
+private:
+    Q_DISABLE_COPY_MOVE(AviationTiles)
+
+    // Number of units per tile edge, and width of the buffer around the tile
+    static constexpr int extent = 4096;
+    static constexpr int buffer = 64;
+
+    // Encodes a tile, without looking at the cache
+    [[nodiscard]] auto encode(int zoom, int x, int y) const -> QByteArray;
+
+    // Bounding box of a tile, including buffer, in Web Mercator coordinates
+    static auto tileBox(int zoom, int x, int y) -> RTree::Box;
+
+    // Cache key for a tile
+    static auto cacheKey(int zoom, int x, int y) -> quint64
+    {
+        return (static_cast<quint64>(zoom) << 48) | (static_cast<quint64>(x) << 24) | static_cast<quint64>(y);
+    }
+
+    // Features, their keys, and spatial index over their bounding boxes
+    QVector<QByteArray> m_keys;
+    QVector<Feature> m_features;
+    QVector<RTree::Box> m_boxes;
+    RTree m_index;
+
+    // Cache of encoded tiles; the cost is the size in bytes. Empty tiles are
+    // cached as empty arrays, with cost one.
+    QMutex m_cacheMutex;
+    QCache<quint64, QByteArray> m_cache {16*1024*1024};
+};
+
+/*! \brief Serialization
+ *
+ *  There is no checks for errors of any kind.
+ */
+QDataStream& operator<<(QDataStream& stream, const GeoMaps::AviationTiles::Feature& feature);
+
+/*! \brief Deserialization
+ *
+ *  There is no checks for errors of any kind.
+ */
+QDataStream& operator>>(QDataStream& stream, GeoMaps::AviationTiles::Feature& feature);
+
+} // namespace GeoMaps
@@ -19,10 +19,9 @@
  ***************************************************************************/
 
 #include <QFile>
-#include <QJsonArray>
-#include <QJsonParseError>
 
 #include "geomaps/GeoJSON.h"
+#include "geomaps/GeoJSONReader.h"
 
 //
 // Methods
@@ -35,33 +34,27 @@ GeoMaps::GeoJSON::fileContent GeoMaps::GeoJSON::inspect(const QString& fileName)
     {
         return GeoMaps::GeoJSON::invalid;
     }
-    auto fileContent = file.readAll();
-    if (fileContent.isEmpty())
-    {
-        return GeoMaps::GeoJSON::invalid;
-    }
-    file.close();
 
-    QJsonParseError parseError{};
-    auto document = QJsonDocument::fromJson(fileContent, &parseError);
-    if (parseError.error != QJsonParseError::NoError)
+    GeoJSONReader reader(&file);
+    QJsonObject feature;
+    if (!reader.readNextFeature(feature))
     {
         return GeoMaps::GeoJSON::invalid;
     }
 
-    auto features = document.object()[QStringLiteral("features")].toArray();
-    if (features.isEmpty())
+    auto wp = GeoMaps::Waypoint(feature);
+    if (!wp.isValid())
     {
         return GeoMaps::GeoJSON::invalid;
     }
 
-    auto wp = GeoMaps::Waypoint(features[0].toObject());
-    if (!wp.isValid())
+    reader.readToEnd();
+    if (reader.hasError())
     {
         return GeoMaps::GeoJSON::invalid;
     }
 
-    auto typeString = document.object()[QStringLiteral("enroute")].toString();
+    auto typeString = reader.topLevelValues()[QStringLiteral("enroute")].toString();
     if (typeString == indicatorFlightRoute())
     {
         return GeoMaps::GeoJSON::flightRoute;
@@ -81,29 +74,23 @@ auto GeoMaps::GeoJSON::read(const QString &fileName) -> QVector<GeoMaps::Waypoin
     {
         return {};
     }
-    auto fileContent = file.readAll();
-    if (fileContent.isEmpty())
-    {
-        return {};
-    }
-    file.close();
-
-    QJsonParseError parseError{};
-    auto document = QJsonDocument::fromJson(fileContent, &parseError);
-    if (parseError.error != QJsonParseError::NoError)
-    {
-        return {};
-    }
 
     QVector<GeoMaps::Waypoint> result;
-    foreach(auto value, document.object()[QStringLiteral("features")].toArray()) {
-        auto wp = GeoMaps::Waypoint(value.toObject());
+    GeoJSONReader reader(&file);
+    QJsonObject feature;
+    while (reader.readNextFeature(feature))
+    {
+        auto wp = GeoMaps::Waypoint(feature);
         if (!wp.isValid())
         {
             return {};
         }
         result.append(wp);
     }
+    if (reader.hasError())
+    {
+        return {};
+    }
 
     return result;
 }
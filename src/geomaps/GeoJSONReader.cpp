@@ -0,0 +1,346 @@
+/***************************************************************************
+ *   Copyright (C) 2023 by Stefan Kebekus                                  *
+ *   stefan.kebekus@gmail.com                                              *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 3 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, write to the                         *
+ *   Free Software Foundation, Inc.,                                       *
+ *   59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.             *
+ ***************************************************************************/
+
+
+#include <QCoreApplication>
+#include <QJsonArray>
+#include <QJsonDocument>
+
+#include "geomaps/GeoJSONReader.h"
+
+
+// Size of the chunks read from the device
+static constexpr qint64 chunkSize = 64*1024;
+
+
+GeoMaps::GeoJSONReader::GeoJSONReader(QIODevice* device)
+    : m_device(device)
+{
+}
+
+
+auto GeoMaps::GeoJSONReader::readNextFeature(QJsonObject& feature) -> bool
+{
+    return advance(&feature);
+}
+
+
+void GeoMaps::GeoJSONReader::readToEnd()
+{
+    while (advance(nullptr))
+    {
+        ;
+    }
+}
+
+
+auto GeoMaps::GeoJSONReader::advance(QJsonObject* feature) -> bool
+{
+    while (true)
+    {
+        switch (m_state)
+        {
+        case State::Done:
+        case State::Error:
+            return false;
+
+        case State::BeforeDocument:
+            // Skip a UTF-8 byte order mark, as QJsonDocument does
+            if (fillBuffer() && (m_position == 0) && m_buffer.startsWith("\xEF\xBB\xBF"))
+            {
+                m_position += 3;
+            }
+            if (peek() != '{')
+            {
+                setError(QCoreApplication::translate("GeoMaps::GeoJSONReader", "Document is not a JSON object"));
+                return false;
+            }
+            m_position++;
+            m_state = State::InDocument;
+            m_needComma = false;
+            break;
+
+        case State::InDocument:
+        {
+            auto next = peek();
+            if (next == '}')
+            {
+                m_position++;
+                m_state = State::Done;
+                return false;
+            }
+            if (m_needComma)
+            {
+                if (next != ',')
+                {
+                    setError(QCoreApplication::translate("GeoMaps::GeoJSONReader", "Missing comma between object members"));
+                    return false;
+                }
+                m_position++;
+                next = peek();
+            }
+            if (next != '"')
+            {
+                setError(QCoreApplication::translate("GeoMaps::GeoJSONReader", "Illegal object member name"));
+                return false;
+            }
+
+            QJsonParseError parseError {};
+            auto key = parseValue(readRawValue(true), &parseError).toString();
+            if (parseError.error != QJsonParseError::NoError)
+            {
+                setError(parseError.errorString());
+                return false;
+            }
+            if (peek() != ':')
+            {
+                setError(QCoreApplication::translate("GeoMaps::GeoJSONReader", "Missing colon after object member name"));
+                return false;
+            }
+            m_position++;
+            m_needComma = true;
+
+            if (key == u"features")
+            {
+                if (peek() != '[')
+                {
+                    setError(QCoreApplication::translate("GeoMaps::GeoJSONReader", "Features are not a JSON array"));
+                    return false;
+                }
+                m_position++;
+                m_state = State::InFeatures;
+                m_needComma = false;
+                break;
+            }
+
+            next = peek();
+            if ((next == ',') || (next == '}') || (next == 0))
+            {
+                setError(QCoreApplication::translate("GeoMaps::GeoJSONReader", "Missing value of object member"));
+                return false;
+            }
+            auto value = parseValue(readRawValue(true), &parseError);
+            if (parseError.error != QJsonParseError::NoError)
+            {
+                setError(parseError.errorString());
+                return false;
+            }
+            m_topLevelValues.insert(key, value);
+            break;
+        }
+
+        case State::InFeatures:
+        {
+            auto next = peek();
+            if (next == ']')
+            {
+                m_position++;
+                m_state = State::InDocument;
+                m_needComma = true;
+                break;
+            }
+            if (m_needComma)
+            {
+                if (next != ',')
+                {
+                    setError(QCoreApplication::translate("GeoMaps::GeoJSONReader", "Missing comma between array elements"));
+                    return false;
+                }
+                m_position++;
+                next = peek();
+            }
+            if ((next == ',') || (next == ']'))
+            {
+                setError(QCoreApplication::translate("GeoMaps::GeoJSONReader", "Missing array element"));
+                return false;
+            }
+            m_needComma = true;
+
+            if (feature == nullptr)
+            {
+                readRawValue(false);
+                if (hasError())
+                {
+                    return false;
+                }
+                break;
+            }
+
+            if (next != '{')
+            {
+                setError(QCoreApplication::translate("GeoMaps::GeoJSONReader", "Feature is not a JSON object"));
+                return false;
+            }
+            QJsonParseError parseError {};
+            auto document = QJsonDocument::fromJson(readRawValue(true), &parseError);
+            if (parseError.error != QJsonParseError::NoError)
+            {
+                setError(parseError.errorString());
+                return false;
+            }
+            *feature = document.object();
+            return true;
+        }
+        }
+    }
+}
+
+
+auto GeoMaps::GeoJSONReader::fillBuffer() -> bool
+{
+    if (m_position < m_buffer.size())
+    {
+        return true;
+    }
+    m_buffer = m_device->read(chunkSize);
+    m_position = 0;
+    return !m_buffer.isEmpty();
+}
+
+
+auto GeoMaps::GeoJSONReader::peek() -> char
+{
+    while (fillBuffer())
+    {
+        auto character = m_buffer[m_position];
+        if ((character != ' ') && (character != '\t') && (character != '\n') && (character != '\r'))
+        {
+            return character;
+        }
+        m_position++;
+    }
+    return 0;
+}
+
+
+auto GeoMaps::GeoJSONReader::readRawValue(bool keep) -> QByteArray
+{
+    QByteArray result;
+    int depth = 0;
+    bool inString = false;
+    bool escaped = false;
+
+    while (fillBuffer())
+    {
+        auto start = m_position;
+        while (m_position < m_buffer.size())
+        {
+            auto character = m_buffer[m_position];
+            if (inString)
+            {
+                m_position++;
+                if (escaped)
+                {
+                    escaped = false;
+                }
+                else if (character == '\\')
+                {
+                    escaped = true;
+                }
+                else if (character == '"')
+                {
+                    inString = false;
+                    if (depth == 0)
+                    {
+                        if (keep)
+                        {
+                            result.append(m_buffer.constData()+start, m_position-start);
+                        }
+                        return result;
+                    }
+                }
+                continue;
+            }
+
+            switch (character)
+            {
+            case '"':
+                inString = true;
+                break;
+            case '{':
+            case '[':
+                depth++;
+                break;
+            case '}':
+            case ']':
+                if (depth == 0)
+                {
+                    // End of a scalar value, the bracket belongs to the parent
+                    if (keep)
+                    {
+                        result.append(m_buffer.constData()+start, m_position-start);
+                    }
+                    return result;
+                }
+                depth--;
+                if (depth == 0)
+                {
+                    m_position++;
+                    if (keep)
+                    {
+                        result.append(m_buffer.constData()+start, m_position-start);
+                    }
+                    return result;
+                }
+                break;
+            case ',':
+            case ' ':
+            case '\t':
+            case '\n':
+            case '\r':
+                if (depth == 0)
+                {
+                    if (keep)
+                    {
+                        result.append(m_buffer.constData()+start, m_position-start);
+                    }
+                    return result;
+                }
+                break;
+            default:
+                break;
+            }
+            m_position++;
+        }
+        if (keep)
+        {
+            result.append(m_buffer.constData()+start, m_position-start);
+        }
+    }
+
+    setError(QCoreApplication::translate("GeoMaps::GeoJSONReader", "Unexpected end of document"));
+    return {};
+}
+
+
+auto GeoMaps::GeoJSONReader::parseValue(const QByteArray& rawValue, QJsonParseError* error) -> QJsonValue
+{
+    // QJsonDocument accepts only objects and arrays, so wrap the value into
+    // an array
+    auto document = QJsonDocument::fromJson("[" + rawValue + "]", error);
+    return document.array().at(0);
+}
+
+
+void GeoMaps::GeoJSONReader::setError(const QString& message)
+{
+    m_state = State::Error;
+    m_errorString = message;
+}
@@ -0,0 +1,161 @@
+/***************************************************************************
+ *   Copyright (C) 2023 by Stefan Kebekus                                  *
+ *   stefan.kebekus@gmail.com                                              *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 3 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, write to the                         *
+ *   Free Software Foundation, Inc.,                                       *
+ *   59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.             *
+ ***************************************************************************/
+
+
+#pragma once
+
+#include <QIODevice>
+#include <QJsonObject>
+
+namespace GeoMaps {
+
+/*! \brief Streaming reader for GeoJSON files
+ *
+ *  This class reads a GeoJSON document of type "FeatureCollection" from a
+ *  QIODevice, in small chunks. Features are handed out one by one, so that at
+ *  no time the whole file or a DOM of the whole document is held in memory.
+ *  A typical use looks like this.
+ *
+ *  @code
+ *  GeoJSONReader reader(&file);
+ *  QJsonObject feature;
+ *  while (reader.readNextFeature(feature))
+ *  {
+ *      ...
+ *  }
+ *  if (reader.hasError())
+ *  {
+ *      ...
+ *  }
+ *  @endcode
+ *
+ *  Top-level members other than "features" (for instance "info" or
+ *  "enroute") are collected and can be accessed with topLevelValues(). If only
+ *  these are of interest, use readToEnd(), which skips over the features
+ *  without parsing them.
+ */
+
+class GeoJSONReader {
+
+public:
+    /*! \brief Constructs a reader
+     *
+     *  @param device Device from which data is read. The device must be open
+     *  and must remain valid for the lifetime of the reader.
+     */
+    explicit GeoJSONReader(QIODevice* device);
+
+    /*! \brief Read the next feature
+     *
+     *  @param feature If a feature could be read, it is stored here
+     *
+     *  @returns True if a feature could be read. False if there are no more
+     *  features, or if an error occurred.
+     */
+    auto readNextFeature(QJsonObject& feature) -> bool;
+
+    /*! \brief Read the remaining document, skipping all features
+     *
+     *  After this method returns, topLevelValues() contains all top-level
+     *  members of the document, except for "features".
+     */
+    void readToEnd();
+
+    /*! \brief Top-level members found so far
+     *
+     *  @returns A JSON object with all top-level members of the document that
+     *  have been read so far, except for "features"
+     */
+    [[nodiscard]] auto topLevelValues() const -> QJsonObject
+    {
+        return m_topLevelValues;
+    }
+
+    /*! \brief Error status
+     *
+     *  @returns True if the document could not be read, or is not valid
+     *  GeoJSON
+     */
+    [[nodiscard]] auto hasError() const -> bool
+    {
+        return m_state == State::Error;
+    }
+
+    /*! \brief Human-readable, translated error message
+     *
+     *  @returns Description of the error, or an empty string if there is no
+     *  error
+     */
+    [[nodiscard]] auto errorString() const -> QString
+    {
+        return m_errorString;
+    }
+
+private:
+    // Position of the reader within the document
+    enum class State {
+        BeforeDocument, // Nothing read yet
+        InDocument,     // Inside the top-level object
+        InFeatures,     // Inside the array of features
+        Done,           // Document completely read
+        Error           // Error occurred
+    };
+
+    // Advances the reader until the next feature has been read, or until the
+    // end of the document. If feature is nullptr, features are skipped
+    // without parsing. Returns true if a feature was read.
+    auto advance(QJsonObject* feature) -> bool;
+
+    // Makes sure that at least one byte is available in m_buffer. Returns
+    // false at the end of the device.
+    auto fillBuffer() -> bool;
+
+    // Skips whitespace and returns the next byte without consuming it.
+    // Returns 0 at the end of the device.
+    auto peek() -> char;
+
+    // Reads one complete JSON value (string, number, object, …), starting at
+    // the current position. If keep is false, the value is skipped and an
+    // empty array is returned.
+    auto readRawValue(bool keep) -> QByteArray;
+
+    // Parses a JSON value that is not necessarily an object or an array
+    static auto parseValue(const QByteArray& rawValue, QJsonParseError* error) -> QJsonValue;
+
+    // Sets m_state to Error and stores the message
+    void setError(const QString& message);
+
+    // Data source
+    QIODevice* m_device;
+
+    // Current chunk of data, and read position within the chunk
+    QByteArray m_buffer;
+    qsizetype m_position {0};
+
+    // Parser state. In the states InDocument and InFeatures, m_needComma
+    // indicates if a comma is expected before the next member or element.
+    State m_state {State::BeforeDocument};
+    bool m_needComma {false};
+
+    QJsonObject m_topLevelValues;
+    QString m_errorString;
+};
+
+} // namespace GeoMaps
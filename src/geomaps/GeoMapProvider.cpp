@@ -18,26 +18,57 @@
  *   59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.             *
  ***************************************************************************/
 
-#include <QImage>
+#include <QCryptographicHash>
+#include <QFileInfo>
 #include <QJsonArray>
 #include <QJsonDocument>
 #include <QJsonObject>
 #include <QLockFile>
 #include <QQmlEngine>
-#include <QRandomGenerator>
+#include <QSaveFile>
+#include <QtConcurrent/QtConcurrentMap>
 #include <QtConcurrent/QtConcurrentRun>
 
 #include "GlobalSettings.h"
-#include "Librarian.h"
 #include "dataManagement/DataManager.h"
+#include "geomaps/GeoJSONReader.h"
 #include "geomaps/GeoMapProvider.h"
 #include "geomaps/MBTILES.h"
 #include "geomaps/WaypointLibrary.h"
 #include "navigation/Navigator.h"
+#include "positioning/PositionProvider.h"
+
+
+namespace {
+
+// Path under which a set of MBTiles files is served. The path depends only
+// on the kind of data and on the names, sizes and modification times of the
+// files. A set that has not changed keeps its path, so that the client can
+// go on using the tiles it has cached.
+auto tileSetPath(const QString& kind, const QList<QPointer<GeoMaps::MBTILES>>& files) -> QString
+{
+    QCryptographicHash hash(QCryptographicHash::Sha1);
+    hash.addData(kind.toUtf8());
+    foreach(auto file, files)
+    {
+        if (file.isNull())
+        {
+            continue;
+        }
+        QFileInfo info(file->fileName());
+        hash.addData(file->fileName().toUtf8());
+        hash.addData(QByteArray::number(info.size()));
+        hash.addData(QByteArray::number(info.lastModified().toMSecsSinceEpoch()));
+    }
+    return QString::fromLatin1(hash.result().toHex().left(16));
+}
+
+} // namespace
 
 
 GeoMaps::GeoMapProvider::GeoMapProvider(QObject *parent)
-    : GlobalObject(parent)
+    : GlobalObject(parent),
+      _tileServer(GlobalSettings::tileCacheSize_default)
 {
     _combinedGeoJSON_ = emptyGeoJSON();
 
@@ -46,6 +77,15 @@ GeoMaps::GeoMapProvider::GeoMapProvider(QObject *parent)
     _combinedGeoJSON_ = geoJSONCacheFile.readAll();
     geoJSONCacheFile.close();
 
+    _tileServer.setAviationData([this]() { return geoJSON(); }, [this]() { return aviationTiles(); });
+}
+
+GeoMaps::GeoMapProvider::~GeoMapProvider()
+{
+    // Stop building overviews, so that the SQLite databases are not written
+    // after this instance is gone
+    m_overviewCanceled.storeRelaxed(1);
+    m_overviewFuture.waitForFinished();
 }
 
 void GeoMaps::GeoMapProvider::deferredInitialization()
@@ -57,6 +97,10 @@ void GeoMaps::GeoMapProvider::deferredInitialization()
     connect(GlobalObject::globalSettings(), &GlobalSettings::airspaceAltitudeLimitChanged, this, &GeoMaps::GeoMapProvider::onAviationMapsChanged);
     connect(GlobalObject::globalSettings(), &GlobalSettings::hideGlidingSectorsChanged, this, &GeoMaps::GeoMapProvider::onAviationMapsChanged);
     connect(GlobalObject::globalSettings(), &GlobalSettings::hillshadingChanged, this, &GeoMaps::GeoMapProvider::onMBTILESChanged);
+    connect(GlobalObject::globalSettings(), &GlobalSettings::tileCacheSizeChanged, this, [this]() { _tileServer.setTileCacheSize(GlobalObject::globalSettings()->tileCacheSize()); });
+    _tileServer.setTileCacheSize(GlobalObject::globalSettings()->tileCacheSize());
+    connect(GlobalObject::positionProvider(), &Positioning::PositionProvider::positionInfoChanged, &m_tilePrefetcher, &GeoMaps::TilePrefetcher::update);
+    connect(GlobalObject::navigator()->flightRoute(), &Navigation::FlightRoute::waypointsChanged, &m_tilePrefetcher, &GeoMaps::TilePrefetcher::reset);
 
     _aviationDataCacheTimer.setSingleShot(true);
     _aviationDataCacheTimer.setInterval(3s);
@@ -127,6 +171,12 @@ auto GeoMaps::GeoMapProvider::geoJSON() -> QByteArray
     return _combinedGeoJSON_;
 }
 
+auto GeoMaps::GeoMapProvider::aviationTiles() -> QSharedPointer<AviationTiles>
+{
+    QMutexLocker lock(&_aviationDataMutex);
+    return _aviationTiles_;
+}
+
 auto GeoMaps::GeoMapProvider::styleFileURL() const -> QString
 {
     if (_styleFile.isNull())
@@ -146,9 +196,13 @@ auto GeoMaps::GeoMapProvider::airspaces(const QGeoCoordinate& position) -> QVari
     // Lock data
     QMutexLocker lock(&_aviationDataMutex);
 
+    // Use the spatial index to find airspaces whose bounding box contains the
+    // position. Only for these, check if the position is inside the polygon.
     QVector<Airspace> result;
     result.reserve(10);
-    foreach(auto airspace, _airspaces_) {
+    const auto candidates = _airspaceIndex_.search(position.longitude(), position.latitude());
+    for(auto index : candidates) {
+        const auto& airspace = _airspaces_[index];
         if (airspace.polygon().contains(position)) {
             result.append(airspace);
         }
@@ -169,29 +223,18 @@ auto GeoMaps::GeoMapProvider::closestWaypoint(QGeoCoordinate position, const QGe
     position.setAltitude(qQNaN());
 
     Waypoint result;
-    const auto wpts = waypoints();
-    for(const auto& wp : wpts) {
-        if (!wp.isValid()) {
-            continue;
-        }
-        if (!result.isValid()) {
-            result = wp;
-        }
-        if (position.distanceTo(wp.coordinate()) < position.distanceTo(result.coordinate())) {
-            result = wp;
+    {
+        QMutexLocker lock(&_aviationDataMutex);
+        auto nearest = _waypointIndex_.nearest(position, 1);
+        if (!nearest.isEmpty()) {
+            result = _waypoints_[nearest[0]];
         }
     }
 
-    const auto wpLibrary = GlobalObject::waypointLibrary()->waypoints();
-    for(const auto& wp : wpLibrary) {
-        if (!wp.isValid()) {
-            continue;
-        }
-        if (!result.isValid()) {
-            result = wp;
-        }
-        if (position.distanceTo(wp.coordinate()) < position.distanceTo(result.coordinate())) {
-            result = wp;
+    auto libraryWaypoint = GlobalObject::waypointLibrary()->closestWaypoint(position);
+    if (libraryWaypoint.isValid()) {
+        if (!result.isValid() || (position.distanceTo(libraryWaypoint.coordinate()) < position.distanceTo(result.coordinate()))) {
+            result = libraryWaypoint;
         }
     }
 
@@ -214,71 +257,7 @@ auto GeoMaps::GeoMapProvider::closestWaypoint(QGeoCoordinate position, const QGe
 
 auto GeoMaps::GeoMapProvider::terrainElevationAMSL(const QGeoCoordinate& coordinate) -> Units::Distance
 {
-    int zoomMin = 6;
-    int zoomMax = 10;
-
-    for(int zoom = zoomMax; zoom >= zoomMin; zoom--)
-    {
-        auto tilex = (coordinate.longitude()+180.0)/360.0 * (1<<zoom);
-        auto tiley = (1.0 - asinh(tan(qDegreesToRadians(coordinate.latitude())))/M_PI)/2.0 * (1<<zoom);
-        auto intraTileX = qRound(255.0*(tilex-floor(tilex)));
-        auto intraTileY = qRound(255.0*(tiley-floor(tiley)));
-
-        qint64 keyA = qFloor(tilex)&0xFFFF;
-        qint64 keyB = qFloor(tiley)&0xFFFF;
-        qint64 key = (keyA<<32) + (keyB<<16) + zoom;
-
-        if (terrainTileCache.contains(key))
-        {
-            auto* tileImg = terrainTileCache.object(key);
-            if (tileImg->isNull())
-            {
-                continue;
-            }
-            auto pix = tileImg->pixel(intraTileX, intraTileY);
-            double elevation = (qRed(pix)*256.0 + qGreen(pix) + qBlue(pix)/256.0) - 32768.0;
-            return Units::Distance::fromM(elevation);
-        }
-    }
-
-
-    foreach(auto mbtPtr, m_terrainMapTiles)
-    {
-        if (mbtPtr.isNull())
-        {
-            continue;
-        }
-
-        for(int zoom = zoomMax; zoom >= zoomMin; zoom--)
-        {
-            auto tilex = (coordinate.longitude()+180.0)/360.0 * (1<<zoom);
-            auto tiley = (1.0 - asinh(tan(qDegreesToRadians(coordinate.latitude())))/M_PI)/2.0 * (1<<zoom);
-            auto intraTileX = qRound(255.0*(tilex-floor(tilex)));
-            auto intraTileY = qRound(255.0*(tiley-floor(tiley)));
-
-            qint64 keyA = qFloor(tilex)&0xFFFF;
-            qint64 keyB = qFloor(tiley)&0xFFFF;
-            qint64 key = (keyA<<32) + (keyB<<16) + zoom;
-
-            auto tileData = mbtPtr->tile(zoom, qFloor(tilex), qFloor(tiley));
-            if (!tileData.isEmpty())
-            {
-                auto* tileImg = new QImage();
-                tileImg->loadFromData(tileData);
-                if (tileImg->isNull())
-                {
-                    delete tileImg;
-                    continue;
-                }
-                terrainTileCache.insert(key,tileImg);
-
-                auto pix = tileImg->pixel(intraTileX, intraTileY);
-                double elevation = (qRed(pix)*256.0 + qGreen(pix) + qBlue(pix)/256.0) - 32768.0;
-                return Units::Distance::fromM(elevation);
-            }
-        }
-    }
-    return {};
+    return m_terrainElevation->elevationAMSL(coordinate);
 }
 
 auto GeoMaps::GeoMapProvider::emptyGeoJSON() -> QByteArray
@@ -292,53 +271,16 @@ auto GeoMaps::GeoMapProvider::emptyGeoJSON() -> QByteArray
 
 auto GeoMaps::GeoMapProvider::filteredWaypoints(const QString &filter) -> QVector<GeoMaps::Waypoint>
 {
-
-    QStringList filterWords;
-    foreach(auto word, filter.simplified().split(' ', Qt::SkipEmptyParts)) {
-        QString simplifiedWord = GlobalObject::librarian()->simplifySpecialChars(word);
-        if (simplifiedWord.isEmpty()) {
-            continue;
-        }
-        filterWords.append(simplifiedWord);
-    }
+    auto filterWords = WaypointSearchIndex::filterWords(filter);
 
     QVector<GeoMaps::Waypoint> result;
-
-    const auto wps = waypoints();
-    for(const auto& wp : wps) {
-        if (!wp.isValid()) {
-            continue;
-        }
-        bool allWordsFound = true;
-        foreach(auto word, filterWords) {
-            QString fullName = GlobalObject::librarian()->simplifySpecialChars(wp.name());
-            if (!fullName.contains(word, Qt::CaseInsensitive) && !wp.ICAOCode().contains(word, Qt::CaseInsensitive)) {
-                allWordsFound = false;
-                break;
-            }
-        }
-        if (allWordsFound) {
-            result.append( wp );
-        }
-    }
-
-    const auto wpsLib = GlobalObject::waypointLibrary()->waypoints();
-    for(const auto& wp : wpsLib) {
-        if (!wp.isValid()) {
-            continue;
-        }
-        bool allWordsFound = true;
-        foreach(auto word, filterWords) {
-            QString fullName = GlobalObject::librarian()->simplifySpecialChars(wp.name());
-            if (!fullName.contains(word, Qt::CaseInsensitive) && !wp.ICAOCode().contains(word, Qt::CaseInsensitive)) {
-                allWordsFound = false;
-                break;
-            }
-        }
-        if (allWordsFound) {
-            result.append( wp );
+    {
+        QMutexLocker lock(&_aviationDataMutex);
+        foreach(auto index, _waypointSearchIndex_.search(filterWords)) {
+            result.append(_waypoints_[index]);
         }
     }
+    result += GlobalObject::waypointLibrary()->matchingWaypoints(filterWords);
 
     std::sort(result.begin(), result.end(), [](const Waypoint& a, const Waypoint& b) {return a.name() < b.name(); });
 
@@ -362,22 +304,16 @@ auto GeoMaps::GeoMapProvider::findByID(const QString &id) -> Waypoint
 
 auto GeoMaps::GeoMapProvider::nearbyWaypoints(const QGeoCoordinate& position, const QString& type) -> QList<GeoMaps::Waypoint>
 {
-    auto wps = waypoints();
-
-    QVector<Waypoint> tWps;
-    foreach(auto wp, wps) {
-        if (!wp.isValid()) {
-            continue;
-        }
-        if (wp.type() != type) {
-            continue;
-        }
-        tWps.append(wp);
-    }
+    QMutexLocker lock(&_aviationDataMutex);
 
-    std::sort(tWps.begin(), tWps.end(), [position](const Waypoint &a, const Waypoint &b) {return position.distanceTo(a.coordinate()) < position.distanceTo(b.coordinate()); });
+    auto indices = _waypointIndex_.nearest(position, 20, [&](qsizetype index) { return _waypoints_[index].type() == type; });
 
-    return tWps.mid(0,20);
+    QList<Waypoint> result;
+    result.reserve(indices.size());
+    foreach(auto index, indices) {
+        result.append(_waypoints_[index]);
+    }
+    return result;
 }
 
 auto GeoMaps::GeoMapProvider::waypoints() -> QVector<Waypoint>
@@ -424,10 +360,16 @@ void GeoMaps::GeoMapProvider::onAviationMapsChanged()
 
 void GeoMaps::GeoMapProvider::onMBTILESChanged()
 {
-    terrainTileCache.clear();
+    // Stop serving tiles before the MBTILES are deleted
+    _tileServer.removeMbtilesFileSet(_currentBaseMapPath);
+    _tileServer.removeMbtilesFileSet(_currentTerrainMapPath);
+
+    delete m_baseMapRasterOverview;
+    delete m_terrainMapOverview;
 
     qDeleteAll(m_baseMapRasterTiles);
     m_baseMapRasterTiles.clear();
+    QStringList baseMapRasterFileNames;
     foreach(auto downloadableX, GlobalObject::dataManager()->baseMapsRaster()->downloadables())
     {
         auto *downloadable = qobject_cast<DataManagement::Downloadable_SingleFile*>(downloadableX);
@@ -441,6 +383,7 @@ void GeoMaps::GeoMapProvider::onMBTILESChanged()
         }
 
         m_baseMapRasterTiles.append(new GeoMaps::MBTILES(downloadable->fileName(), this));
+        baseMapRasterFileNames.append(downloadable->fileName());
     }
     qDeleteAll(m_baseMapVectorTiles);
     m_baseMapVectorTiles.clear();
@@ -462,6 +405,7 @@ void GeoMaps::GeoMapProvider::onMBTILESChanged()
 
     qDeleteAll(m_terrainMapTiles);
     m_terrainMapTiles.clear();
+    QStringList terrainMapFileNames;
     foreach(auto downloadableX, GlobalObject::dataManager()->terrainMaps()->downloadables())
     {
         auto *downloadable = qobject_cast<DataManagement::Downloadable_SingleFile*>(downloadableX);
@@ -475,37 +419,114 @@ void GeoMaps::GeoMapProvider::onMBTILESChanged()
         }
 
         m_terrainMapTiles.append(new GeoMaps::MBTILES(downloadable->fileName(), this));
+        terrainMapFileNames.append(downloadable->fileName());
     }
+    m_terrainElevation->setFileNames(terrainMapFileNames);
     emit terrainMapTilesChanged();
 
-    // Delete old style file, stop serving tiles
-    delete _styleFile;
-    _tileServer.removeMbtilesFileSet(_currentBaseMapPath);
-    _tileServer.removeMbtilesFileSet(_currentTerrainMapPath);
-    _currentBaseMapPath = QString::number(QRandomGenerator::global()->bounded(static_cast<quint32>(1000000000)));
-    _currentTerrainMapPath = QString::number(QRandomGenerator::global()->bounded(static_cast<quint32>(1000000000)));
+    // Overview tiles. Overviews that do not exist yet are built in the
+    // background. Once they are ready, this method runs again and serves them.
+    QStringList overviewFileNames;
+    QList<QPair<QStringList, GeoMaps::OverviewTiles::Encoding>> missingOverviews;
+    auto overview = [&](const QStringList& sourceFileNames, GeoMaps::OverviewTiles::Encoding encoding) -> GeoMaps::MBTILES* {
+        if (sourceFileNames.isEmpty())
+        {
+            return nullptr;
+        }
+        auto overviewFileName = GeoMaps::OverviewTiles::fileName(sourceFileNames);
+        overviewFileNames.append(overviewFileName);
+        if (QFile::exists(overviewFileName))
+        {
+            return new GeoMaps::MBTILES(overviewFileName, this);
+        }
+        missingOverviews.append({sourceFileNames, encoding});
+        return nullptr;
+    };
+    m_baseMapRasterOverview = overview(baseMapRasterFileNames, GeoMaps::OverviewTiles::Encoding::Image);
+    m_terrainMapOverview = overview(terrainMapFileNames, GeoMaps::OverviewTiles::Encoding::Terrarium);
+    if (m_overviewFuture.isFinished())
+    {
+        m_overviewCheckPending = false;
+        GeoMaps::OverviewTiles::removeUnused(overviewFileNames);
+        if (!missingOverviews.isEmpty())
+        {
+            m_overviewFuture = QtConcurrent::run([missingOverviews, &canceled = m_overviewCanceled]() {
+                bool built = false;
+                foreach(auto missingOverview, missingOverviews)
+                {
+                    if (canceled.loadRelaxed() != 0)
+                    {
+                        break;
+                    }
+                    built = GeoMaps::OverviewTiles::build(missingOverview.first, missingOverview.second, canceled) || built;
+                }
+                return built;
+            });
+            // The continuation is not stored in m_overviewFuture, because it
+            // runs in the main thread and the destructor cannot wait for it.
+            // It is not called if this instance is destroyed first.
+            m_overviewFuture.then(this, [this](bool built) {
+                if (built || m_overviewCheckPending)
+                {
+                    onMBTILESChanged();
+                }
+            });
+        }
+    }
+    else
+    {
+        // Overviews that are missing now are not built by the running job.
+        // Check again once the job is done.
+        m_overviewCheckPending = true;
+    }
 
-    QFile file;
     if (GlobalObject::dataManager()->baseMaps()->hasFile())
     {
-        // Serve new tile set under new name
+        // Serve tile set under a name that changes with the files
         if (!m_baseMapRasterTiles.isEmpty())
         {
-            _tileServer.addMbtilesFileSet(_currentBaseMapPath, m_baseMapRasterTiles);
-            file.setFileName(QStringLiteral(":/flightMap/mapstyle-raster.json"));
+            // The overview comes first, so that it is preferred over the
+            // individual files at low zoom levels
+            auto baseMapRasterTiles = m_baseMapRasterTiles;
+            if (!m_baseMapRasterOverview.isNull())
+            {
+                baseMapRasterTiles.prepend(m_baseMapRasterOverview);
+            }
+            _currentBaseMapPath = tileSetPath(QStringLiteral("raster"), baseMapRasterTiles);
+            _tileServer.addMbtilesFileSet(_currentBaseMapPath, baseMapRasterTiles);
+            _styleFileTemplate = QStringLiteral(":/flightMap/mapstyle-raster.json");
         }
         else
         {
+            _currentBaseMapPath = tileSetPath(QStringLiteral("vector"), m_baseMapVectorTiles);
             _tileServer.addMbtilesFileSet(_currentBaseMapPath, m_baseMapVectorTiles);
-            file.setFileName(QStringLiteral(":/flightMap/osm-liberty.json"));
+            _styleFileTemplate = QStringLiteral(":/flightMap/osm-liberty.json");
         }
     }
     else
     {
-        file.setFileName(QStringLiteral(":/flightMap/empty.json"));
+        _currentBaseMapPath.clear();
+        _styleFileTemplate = QStringLiteral(":/flightMap/empty.json");
+    }
+    auto terrainMapTiles = m_terrainMapTiles;
+    if (!m_terrainMapOverview.isNull())
+    {
+        terrainMapTiles.prepend(m_terrainMapOverview);
+    }
+    _currentTerrainMapPath = tileSetPath(QStringLiteral("terrain"), terrainMapTiles);
+    _tileServer.addMbtilesFileSet(_currentTerrainMapPath, terrainMapTiles);
+
+    writeStyleFile();
+}
+
+void GeoMaps::GeoMapProvider::writeStyleFile()
+{
+    if (_styleFileTemplate.isEmpty())
+    {
+        return;
     }
-    _tileServer.addMbtilesFileSet(_currentTerrainMapPath, m_terrainMapTiles);
 
+    QFile file(_styleFileTemplate);
     file.open(QIODevice::ReadOnly);
     QByteArray data = file.readAll();
     data.replace("%URL%", (_tileServer.serverUrl()+"/"+_currentBaseMapPath).toLatin1());
@@ -518,10 +539,15 @@ void GeoMaps::GeoMapProvider::onMBTILESChanged()
         data.replace("%URLT%", (_tileServer.serverUrl()).toLatin1());
     }
     data.replace("%URL2%", _tileServer.serverUrl().toLatin1());
-    _styleFile = new QTemporaryFile(this);
-    _styleFile->open();
-    _styleFile->write(data);
-    _styleFile->close();
+
+    // Write the new style file before deleting the old one, so that the file
+    // name, and with it the style file URL, is guaranteed to change
+    auto* newStyleFile = new QTemporaryFile(this);
+    newStyleFile->open();
+    newStyleFile->write(data);
+    newStyleFile->close();
+    delete _styleFile;
+    _styleFile = newStyleFile;
 
     emit styleFileURLChanged();
 }
@@ -535,98 +561,151 @@ void GeoMaps::GeoMapProvider::fillAviationDataCache(QStringList JSONFileNames, U
     JSONFileNames.sort();
 
     //
-    // Generate new GeoJSON array and new list of waypoints
+    // Update the cache of parsed files. Only files that are new or that have
+    // changed since the last run are read and parsed. The cache is read from
+    // disk on every run and is not kept in memory between runs, because it
+    // holds every feature in several forms.
     //
+    auto parsedAviationFiles = loadParsedAviationFiles();
+    bool parsedAviationFilesChanged = false;
+    foreach(auto JSONFileName, parsedAviationFiles.keys()) {
+        if (!JSONFileNames.contains(JSONFileName)) {
+            parsedAviationFiles.remove(JSONFileName);
+            parsedAviationFilesChanged = true;
+        }
+    }
+    QStringList JSONFileNamesToParse;
+    foreach(auto JSONFileName, JSONFileNames) {
+        QFileInfo fileInfo(JSONFileName);
+        auto cacheIterator = parsedAviationFiles.constFind(JSONFileName);
+        if ((cacheIterator != parsedAviationFiles.constEnd())
+                && (cacheIterator->lastModified == fileInfo.lastModified())
+                && (cacheIterator->size == fileInfo.size())) {
+            continue;
+        }
+        JSONFileNamesToParse << JSONFileName;
+    }
 
-    // First, create a vector of JSON objects.
-    // We use a QSet to keep track of objects that have already been added in order to avoid duplicated entries.
-    // The vector is used to ensure that the order of the objects remains identical during runs.
-    // A QSet seems to have some built-in randomness and does not do that.
-    QVector<QJsonObject> objectVector;
-    {
-        QSet<QJsonObject> objectSet;
-        foreach(auto JSONFileName, JSONFileNames) {
-            // Read the lock file
-            QLockFile lockFile(JSONFileName+".lock");
-            lockFile.lock();
-            QFile file(JSONFileName);
-            file.open(QIODevice::ReadOnly);
-            auto document = QJsonDocument::fromJson(file.readAll());
-            file.close();
-            lockFile.unlock();
-
-            foreach(auto value, document.object()[QStringLiteral("features")].toArray())
-            {
-                auto object = value.toObject();
-                if (objectSet.contains(object))
-                {
-                    continue;
-                }
-                objectVector += object;
-                objectSet += object;
-            }
+    // Parse files in parallel. The results come in the same order as the
+    // file names.
+    if (!JSONFileNamesToParse.isEmpty()) {
+        auto newParsedFiles = QtConcurrent::blockingMapped<QVector<ParsedAviationFile>>(JSONFileNamesToParse, &GeoMaps::GeoMapProvider::parseAviationFile);
+        for(qsizetype i=0; i<JSONFileNamesToParse.size(); i++) {
+            parsedAviationFiles.insert(JSONFileNamesToParse[i], newParsedFiles[i]);
         }
+        parsedAviationFilesChanged = true;
     }
 
-    // Create vectors of airspaces and waypoints
+    //
+    // Generate new GeoJSON document, new list of waypoints and new list of
+    // airspaces.
+    //
+    // We use a QSet to keep track of features that have already been added in
+    // order to avoid duplicated entries.  Features are compared by their
+    // compact JSON serialization.  Files are handled in sorted order, to
+    // ensure that the order of the objects remains identical during runs.
+    //
     QVector<Airspace> newAirspaces;
     QVector<Waypoint> newWaypoints;
-    foreach(auto object, objectVector) {
-        // Check if the current object is a waypoint. If so, add it to the list of waypoints.
-        Waypoint wp(object);
-        if (wp.isValid()) {
-            newWaypoints.append(wp);
-            continue;
-        }
+    QVector<QByteArray> newTileKeys;
+    QVector<AviationTiles::Feature> newTileFeatures;
+    QByteArray newGeoJSON = "{\"features\":[";
+    {
+        QSet<QByteArray> featureSet;
+        bool firstFeature = true;
+        foreach(auto JSONFileName, JSONFileNames) {
+            foreach(auto feature, parsedAviationFiles.value(JSONFileName).features) {
+                if (featureSet.contains(feature.json)) {
+                    continue;
+                }
+                featureSet += feature.json;
 
-        // Check if the current object is an airspace. If so, add it to the list of airspaces.
-        Airspace as(object);
-        if (as.isValid()) {
-            newAirspaces.append(as);
-            continue;
-        }
-    }
+                if (feature.waypoint.isValid()) {
+                    newWaypoints.append(feature.waypoint);
+                } else if (feature.airspace.isValid()) {
+                    newAirspaces.append(feature.airspace);
+                }
 
-    // Then, create a new JSONArray of features and a new list of waypoints
-    QJsonArray newFeatures;
-    foreach(auto object, objectVector) {
-        // Ignore all objects that are airspaces and that begin above the airspaceAltitudeLimit.
-        Airspace airspaceTest(object);
-        if (airspaceAltitudeLimit.isFinite() && (airspaceTest.estimatedLowerBoundMSL() > airspaceAltitudeLimit)) {
-            continue;
-        }
+                // Ignore all airspaces that begin above the airspaceAltitudeLimit.
+                if (airspaceAltitudeLimit.isFinite() && (feature.airspace.estimatedLowerBoundMSL() > airspaceAltitudeLimit)) {
+                    continue;
+                }
 
-        // If 'hideGlidingSector' is set, ignore all objects that are airspaces
-        // and that are gliding sectors
-        if (hideGlidingSectors) {
-            Airspace airspaceTest(object);
-            if (airspaceTest.CAT() == u"GLD"_qs) {
-                continue;
+                // If 'hideGlidingSector' is set, ignore all airspaces that are
+                // gliding sectors
+                if (hideGlidingSectors && (feature.airspace.CAT() == u"GLD"_qs)) {
+                    continue;
+                }
+
+                if (!firstFeature) {
+                    newGeoJSON += ',';
+                }
+                newGeoJSON += feature.json;
+                firstFeature = false;
+
+                if (feature.tileFeature.isValid()) {
+                    newTileKeys.append(feature.json);
+                    newTileFeatures.append(feature.tileFeature);
+                }
             }
         }
-
-        newFeatures += object;
     }
+    newGeoJSON += "],\"type\":\"FeatureCollection\"}";
 
-    QByteArray newGeoJSON;
-    {
-        QJsonObject resultObject;
-        resultObject.insert(QStringLiteral("type"), "FeatureCollection");
-        resultObject.insert(QStringLiteral("features"), newFeatures);
-        QJsonDocument geoDoc(resultObject);
-        newGeoJSON = geoDoc.toJson();
+    // Create spatial index for the airspaces
+    QVector<RTree::Box> newAirspaceBoxes;
+    newAirspaceBoxes.reserve(newAirspaces.size());
+    foreach(auto airspace, newAirspaces) {
+        newAirspaceBoxes.append(RTree::Box::fromPolygon(airspace.polygon()));
     }
-    auto _geoJSONChanged = (newGeoJSON != _combinedGeoJSON_);
-    auto _waypointsChanged = (newWaypoints != _waypoints_);
+    RTree newAirspaceIndex(newAirspaceBoxes);
 
     // Sort waypoints by name
     std::sort(newWaypoints.begin(), newWaypoints.end(), [](const Waypoint &a, const Waypoint &b) {return a.name() < b.name(); });
 
+    auto _geoJSONChanged = (newGeoJSON != _combinedGeoJSON_);
+    auto _waypointsChanged = (newWaypoints != _waypoints_);
+
+    // Cut the GeoJSON into vector tiles. Tiles that are not affected by the
+    // changes are taken over from the old tile set.
+    auto oldAviationTiles = aviationTiles();
+    auto _aviationTilesChanged = _geoJSONChanged || oldAviationTiles.isNull();
+    QSharedPointer<AviationTiles> newAviationTiles;
+    if (_aviationTilesChanged)
+    {
+        newAviationTiles = QSharedPointer<AviationTiles>(new AviationTiles(newTileKeys, newTileFeatures));
+        if (!oldAviationTiles.isNull())
+        {
+            newAviationTiles->inheritCache(*oldAviationTiles);
+        }
+    }
+
+    // Create spatial and search index for the waypoints
+    KDTree newWaypointIndex;
+    WaypointSearchIndex newWaypointSearchIndex;
+    if (_waypointsChanged)
+    {
+        QVector<QGeoCoordinate> newWaypointCoordinates;
+        newWaypointCoordinates.reserve(newWaypoints.size());
+        foreach(auto waypoint, newWaypoints) {
+            newWaypointCoordinates.append(waypoint.coordinate());
+        }
+        newWaypointIndex = KDTree(newWaypointCoordinates);
+        newWaypointSearchIndex = WaypointSearchIndex(newWaypoints);
+    }
+
     _aviationDataMutex.lock();
     _airspaces_ = newAirspaces;
+    _airspaceIndex_ = newAirspaceIndex;
     if (_waypointsChanged)
     {
         _waypoints_ = newWaypoints;
+        _waypointIndex_ = newWaypointIndex;
+        _waypointSearchIndex_ = newWaypointSearchIndex;
+    }
+    if (_aviationTilesChanged)
+    {
+        _aviationTiles_ = newAviationTiles;
     }
     if (_geoJSONChanged)
     {
@@ -646,5 +725,131 @@ void GeoMaps::GeoMapProvider::fillAviationDataCache(QStringList JSONFileNames, U
     {
         emit geoJSONChanged();
     }
+    if (_aviationTilesChanged)
+    {
+        // MapLibre does not request aviation tiles again on its own. Reload
+        // the style, so that the new tiles are shown.
+        QMetaObject::invokeMethod(this, &GeoMaps::GeoMapProvider::writeStyleFile, Qt::QueuedConnection);
+    }
+
+    // Save parsed data, so that we do not need to parse again on next start
+    if (parsedAviationFilesChanged)
+    {
+        saveParsedAviationFiles(parsedAviationFiles);
+    }
+}
+
+
+auto GeoMaps::GeoMapProvider::parseAviationFile(const QString& JSONFileName) -> ParsedAviationFile
+{
+    // Read the lock file
+    QLockFile lockFile(JSONFileName+".lock");
+    lockFile.lock();
+
+    ParsedAviationFile parsedFile;
+    QFileInfo fileInfo(JSONFileName);
+    parsedFile.lastModified = fileInfo.lastModified();
+    parsedFile.size = fileInfo.size();
+    QFile file(JSONFileName);
+    file.open(QIODevice::ReadOnly);
+    GeoJSONReader reader(&file);
+    QJsonObject object;
+    while (reader.readNextFeature(object)) {
+        AviationFeature feature;
+        feature.json = QJsonDocument(object).toJson(QJsonDocument::Compact);
+        feature.waypoint = Waypoint(object);
+        if (!feature.waypoint.isValid()) {
+            feature.airspace = Airspace(object);
+        }
+        feature.tileFeature = AviationTiles::Feature::fromGeoJSON(object);
+        parsedFile.features.append(feature);
+    }
+    file.close();
+    lockFile.unlock();
+
+    // Files that cannot be read completely are ignored
+    if (reader.hasError()) {
+        parsedFile.features.clear();
+    }
+    return parsedFile;
+}
+
+
+auto GeoMaps::GeoMapProvider::loadParsedAviationFiles() const -> QHash<QString, ParsedAviationFile>
+{
+    auto inputFile = QFile(aviationDataBinaryCache);
+    if (!inputFile.open(QIODevice::ReadOnly))
+    {
+        return {};
+    }
 
+    QDataStream inputStream(&inputFile);
+    QString magicString;
+    inputStream >> magicString;
+    if (magicString != QStringLiteral(GIT_COMMIT))
+    {
+        return {};
+    }
+    quint32 version = 0;
+    inputStream >> version;
+    if (version != aviationDataBinaryCacheVersion)
+    {
+        return {};
+    }
+
+    QHash<QString, ParsedAviationFile> parsedFiles;
+    qint64 numFiles = 0;
+    inputStream >> numFiles;
+    for(qint64 i=0; (i<numFiles) && (inputStream.status() == QDataStream::Ok); i++)
+    {
+        QString fileName;
+        ParsedAviationFile parsedFile;
+        qint64 numFeatures = 0;
+        inputStream >> fileName >> parsedFile.lastModified >> parsedFile.size >> numFeatures;
+        for(qint64 j=0; j<numFeatures; j++)
+        {
+            if (inputStream.status() != QDataStream::Ok)
+            {
+                return {};
+            }
+            AviationFeature feature;
+            inputStream >> feature.json >> feature.waypoint >> feature.airspace >> feature.tileFeature;
+            parsedFile.features.append(feature);
+        }
+        parsedFiles.insert(fileName, parsedFile);
+    }
+    if (inputStream.status() != QDataStream::Ok)
+    {
+        return {};
+    }
+    return parsedFiles;
+}
+
+
+void GeoMaps::GeoMapProvider::saveParsedAviationFiles(const QHash<QString, ParsedAviationFile>& parsedAviationFiles) const
+{
+    QSaveFile outputFile(aviationDataBinaryCache);
+    if (!outputFile.open(QIODevice::WriteOnly))
+    {
+        return;
+    }
+
+    QDataStream outputStream(&outputFile);
+    outputStream << QStringLiteral(GIT_COMMIT);
+    outputStream << aviationDataBinaryCacheVersion;
+    outputStream << static_cast<qint64>(parsedAviationFiles.size());
+    for(auto it = parsedAviationFiles.constBegin(); it != parsedAviationFiles.constEnd(); it++)
+    {
+        outputStream << it.key() << it->lastModified << it->size << static_cast<qint64>(it->features.size());
+        foreach(auto feature, it->features)
+        {
+            outputStream << feature.json << feature.waypoint << feature.airspace << feature.tileFeature;
+        }
+    }
+    if (outputStream.status() != QDataStream::Ok)
+    {
+        outputFile.cancelWriting();
+        return;
+    }
+    outputFile.commit();
 }
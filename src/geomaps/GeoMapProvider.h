@@ -20,9 +20,7 @@
 
 #pragma once
 
-#include <QCache>
 #include <QFuture>
-#include <QImage>
 #include <QQmlEngine>
 #include <QStandardPaths>
 #include <QTemporaryFile>
@@ -32,7 +30,14 @@
 #include "GlobalObject.h"
 #include "TileServer.h"
 #include "Waypoint.h"
+#include "geomaps/AviationTiles.h"
+#include "geomaps/KDTree.h"
 #include "geomaps/MBTILES.h"
+#include "geomaps/OverviewTiles.h"
+#include "geomaps/RTree.h"
+#include "geomaps/TerrainElevation.h"
+#include "geomaps/TilePrefetcher.h"
+#include "geomaps/WaypointSearchIndex.h"
 
 namespace GeoMaps
 {
@@ -84,7 +89,7 @@ public:
     }
 
     /*! \brief Destructor */
-    ~GeoMapProvider() override = default;
+    ~GeoMapProvider() override;
 
 
     //
@@ -167,6 +172,18 @@ public:
      */
     [[nodiscard]] auto geoJSON() -> QByteArray;
 
+    /*! \brief Aviation data as vector tiles
+     *
+     * This method returns the content of the property geoJSON, cut into vector
+     * tiles. The TileServer uses this to serve the aviation data to the map.
+     * The tile set is replaced whenever geoJSON changes. The returned object
+     * is thread-safe.
+     *
+     * @returns Vector tiles with aviation data, or nullptr if the aviation
+     * data has not been read yet
+     */
+    [[nodiscard]] auto aviationTiles() -> QSharedPointer<AviationTiles>;
+
     /*! \brief Getter function for the property with the same name
      *
      * @returns Property styleFileURL
@@ -230,6 +247,8 @@ public:
     }
 
     /*! \brief Elevation of terrain at a given coordinate, above sea level
+     *
+     *  This method is thread-safe.
      *
      *  @param coordinate Coordinate
      *
@@ -238,6 +257,19 @@ public:
      */
     Q_INVOKABLE [[nodiscard]] Units::Distance terrainElevationAMSL(const QGeoCoordinate& coordinate);
 
+    /*! \brief Terrain elevation service
+     *
+     *  Worker threads that sample many elevations should hold this pointer
+     *  rather than a pointer to the GeoMapProvider. The service owns its terrain
+     *  maps and remains valid even if the GeoMapProvider is deleted.
+     *
+     *  @returns Terrain elevation service, which is never null
+     */
+    [[nodiscard]] auto terrainElevation() const -> QSharedPointer<GeoMaps::TerrainElevation>
+    {
+        return m_terrainElevation;
+    }
+
     /*! \brief Create empty GeoJSON document
      *
      *  @returns Empty, but valid GeoJSON document
@@ -304,18 +336,19 @@ private:
     // sets up the tile server to and generates a new style file.
     void onMBTILESChanged();
 
+    // Writes a new style file from _styleFileTemplate and emits
+    // styleFileURLChanged(). Because the file name changes, MapLibre reloads
+    // the style and requests all tiles again.
+    void writeStyleFile();
+
     // Interal function that does most of the work for aviationMapsChanged()
     // emits geoJSONChanged() when done. This function is meant to be run in a
     // separate thread.
     void fillAviationDataCache(QStringList JSONFileNames, Units::Distance airspaceAltitudeLimit, bool hideGlidingSectors);
 
-    // Caches used to speed up the method simplifySpecialChars
-    QRegularExpression specialChars{QStringLiteral("[^a-zA-Z0-9]")};
-    QHash<QString, QString> simplifySpecialChars_cache;
-
     // This is the path under which map tiles are available on the _tileServer.
-    // This is set to a random number that changes every time the set of MBTile
-    // files changes
+    // This is a hash of the MBTile files, which changes every time the set of
+    // files or one of the files changes
     QString _currentBaseMapPath;
     QString _currentTerrainMapPath;
 
@@ -325,12 +358,45 @@ private:
     // Temporary file that holds the current style file
     QPointer<QTemporaryFile> _styleFile;
 
+    // Resource that serves as a template for the style file
+    QString _styleFileTemplate;
+
     //
     // Aviation Data Cache
     //
     QFuture<void> _aviationDataCacheFuture; // Future; indicates if fillAviationDataCache() is currently running
     QTimer _aviationDataCacheTimer;         // Timer used to start another run of fillAviationDataCache()
 
+    // Parsed content of a GeoJSON file, as used by fillAviationDataCache(). For
+    // every feature, the compact JSON serialization is stored, together with
+    // the waypoint or airspace that the feature describes (or invalid
+    // objects, if the feature is not a waypoint or an airspace) and the
+    // projected geometry used for vector tiles.
+    struct AviationFeature {
+        QByteArray json;
+        Waypoint waypoint;
+        Airspace airspace;
+        AviationTiles::Feature tileFeature;
+    };
+    struct ParsedAviationFile {
+        QDateTime lastModified;
+        qint64 size {-1};
+        QVector<AviationFeature> features;
+    };
+
+
+    // Reads and parses one GeoJSON file. This method is thread-safe and is
+    // run in parallel for several files by fillAviationDataCache().
+    static auto parseAviationFile(const QString& JSONFileName) -> ParsedAviationFile;
+
+    // Read parsed GeoJSON files, accessible by file name, from
+    // aviationDataBinaryCache, and write them back. These methods are called
+    // from fillAviationDataCache() only. The method loadParsedAviationFiles()
+    // fails silently on error, returning an empty hash.
+    [[nodiscard]] auto loadParsedAviationFiles() const -> QHash<QString, ParsedAviationFile>;
+    void saveParsedAviationFiles(const QHash<QString, ParsedAviationFile>& parsedAviationFiles) const;
+    static constexpr quint32 aviationDataBinaryCacheVersion = 2;
+
     //
     // MBTILES
     //
@@ -338,19 +404,43 @@ private:
     QList<QPointer<GeoMaps::MBTILES>> m_baseMapRasterTiles;
     QList<QPointer<GeoMaps::MBTILES>> m_terrainMapTiles;
 
+    // Overview tiles for the raster base maps and for the terrain maps, or
+    // nullptr if not available. Missing overviews are built in the
+    // background; m_overviewFuture indicates if this is currently running.
+    // Setting m_overviewCanceled stops the build. If overviews go missing
+    // while a build is running, m_overviewCheckPending is set, and
+    // onMBTILESChanged() runs again once the build is done.
+    QPointer<GeoMaps::MBTILES> m_baseMapRasterOverview;
+    QPointer<GeoMaps::MBTILES> m_terrainMapOverview;
+    QFuture<bool> m_overviewFuture;
+    QAtomicInt m_overviewCanceled {0};
+    bool m_overviewCheckPending {false};
+
     // The data in this group is accessed by several threads. The following
     // classes (whose names ends in an underscore) are therefore protected by
     // this mutex.
     QMutex _aviationDataMutex;
     QByteArray _combinedGeoJSON_;  // Cache: GeoJSON
+    QSharedPointer<AviationTiles> _aviationTiles_; // Cache: GeoJSON, as vector tiles; nullptr until first run of fillAviationDataCache()
     QList<Waypoint> _waypoints_; // Cache: Waypoints
+    KDTree _waypointIndex_;      // Spatial index for _waypoints_, items are indices into _waypoints_
+    WaypointSearchIndex _waypointSearchIndex_; // Search index for _waypoints_, items are indices into _waypoints_
     QList<Airspace> _airspaces_; // Cache: Airspaces
+    RTree _airspaceIndex_;       // Spatial index for _airspaces_, items are indices into _airspaces_
 
-    // TerrainImageCache
-    QCache<qint64,QImage> terrainTileCache {6}; // Hold 6 tiles, roughly 1.2MB
+    // Terrain elevation, read from the terrain maps
+    QSharedPointer<TerrainElevation> m_terrainElevation {new TerrainElevation};
+
+    // Loads tiles and terrain data for the area ahead of the aircraft. This
+    // member is declared after the objects it uses, so that it is destroyed
+    // first.
+    TilePrefetcher m_tilePrefetcher {&_tileServer, m_terrainElevation.data()};
 
     // GeoJSON file
     QString geoJSONCache {QStandardPaths::writableLocation(QStandardPaths::AppDataLocation)+"/aviationData.json"};
+
+    // Binary file holding the parsed GeoJSON files
+    QString aviationDataBinaryCache {QStandardPaths::writableLocation(QStandardPaths::AppDataLocation)+"/aviationData.bin"};
 };
 
 } // namespace GeoMaps
@@ -0,0 +1,231 @@
+/***************************************************************************
+ *   Copyright (C) 2023 by Stefan Kebekus                                  *
+ *   stefan.kebekus@gmail.com                                              *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 3 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, write to the                         *
+ *   Free Software Foundation, Inc.,                                       *
+ *   59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.             *
+ ***************************************************************************/
+
+
+#include <QtMath>
+#include <queue>
+
+#include "geomaps/KDTree.h"
+
+
+// Mean radius of the earth, as used by QGeoCoordinate::distanceTo()
+static constexpr double earthRadiusInM = 6371007.2;
+
+
+GeoMaps::KDTree::KDTree(const QVector<QGeoCoordinate>& coordinates)
+{
+    m_points.reserve(coordinates.size());
+    for(qsizetype i=0; i<coordinates.size(); i++)
+    {
+        if (!coordinates[i].isValid())
+        {
+            continue;
+        }
+        m_points.append({toPoint(coordinates[i]), i});
+    }
+    build(0, m_points.size(), 0);
+}
+
+
+auto GeoMaps::KDTree::toPoint(const QGeoCoordinate& coordinate) -> std::array<double, 3>
+{
+    auto lat = qDegreesToRadians(coordinate.latitude());
+    auto lon = qDegreesToRadians(coordinate.longitude());
+    return {qCos(lat)*qCos(lon), qCos(lat)*qSin(lon), qSin(lat)};
+}
+
+
+auto GeoMaps::KDTree::squaredDistance(const std::array<double, 3>& a, const std::array<double, 3>& b) -> double
+{
+    auto dx = a[0]-b[0];
+    auto dy = a[1]-b[1];
+    auto dz = a[2]-b[2];
+    return dx*dx + dy*dy + dz*dz;
+}
+
+
+void GeoMaps::KDTree::build(qsizetype begin, qsizetype end, int axis)
+{
+    if (end-begin <= leafSize)
+    {
+        return;
+    }
+
+    auto mid = begin + (end-begin)/2;
+    std::nth_element(m_points.begin()+begin, m_points.begin()+mid, m_points.begin()+end,
+                     [axis](const Point& a, const Point& b) { return a.xyz[axis] < b.xyz[axis]; });
+    build(begin, mid, (axis+1)%3);
+    build(mid+1, end, (axis+1)%3);
+}
+
+
+auto GeoMaps::KDTree::nearest(const QGeoCoordinate& position, qsizetype k, const std::function<bool(qsizetype)>& filter) const -> QVector<qsizetype>
+{
+    if (!position.isValid() || (k <= 0) || m_points.isEmpty())
+    {
+        return {};
+    }
+    auto query = toPoint(position);
+
+    // Max-heap holding the best candidates found so far, as pairs of squared
+    // distance and index
+    std::priority_queue<std::pair<double, qsizetype>> best;
+    auto consider = [&](const Point& point) {
+        if (filter && !filter(point.index))
+        {
+            return;
+        }
+        auto dist = squaredDistance(query, point.xyz);
+        if (best.size() < static_cast<size_t>(k))
+        {
+            best.emplace(dist, point.index);
+        }
+        else if (dist < best.top().first)
+        {
+            best.pop();
+            best.emplace(dist, point.index);
+        }
+    };
+
+    // Subtrees that still need to be examined, together with a lower bound for
+    // the squared distance between the query point and points in the subtree
+    struct Range {
+        qsizetype begin;
+        qsizetype end;
+        int axis;
+        double minDist;
+    };
+    QVector<Range> stack;
+    stack.append({0, m_points.size(), 0, 0.0});
+    while (!stack.isEmpty())
+    {
+        auto range = stack.takeLast();
+        if ((best.size() == static_cast<size_t>(k)) && (range.minDist >= best.top().first))
+        {
+            continue;
+        }
+
+        if (range.end-range.begin <= leafSize)
+        {
+            for(auto i=range.begin; i<range.end; i++)
+            {
+                consider(m_points[i]);
+            }
+            continue;
+        }
+
+        auto mid = range.begin + (range.end-range.begin)/2;
+        consider(m_points[mid]);
+
+        // Push the far side first, so that the near side is examined first
+        auto diff = query[range.axis] - m_points[mid].xyz[range.axis];
+        auto nextAxis = (range.axis+1)%3;
+        Range lower {range.begin, mid, nextAxis, range.minDist};
+        Range upper {mid+1, range.end, nextAxis, range.minDist};
+        if (diff < 0)
+        {
+            upper.minDist = qMax(range.minDist, diff*diff);
+            stack.append(upper);
+            stack.append(lower);
+        }
+        else
+        {
+            lower.minDist = qMax(range.minDist, diff*diff);
+            stack.append(lower);
+            stack.append(upper);
+        }
+    }
+
+    QVector<qsizetype> result(static_cast<qsizetype>(best.size()));
+    for(auto i=result.size()-1; i>=0; i--)
+    {
+        result[i] = best.top().second;
+        best.pop();
+    }
+    return result;
+}
+
+
+auto GeoMaps::KDTree::withinRadius(const QGeoCoordinate& position, Units::Distance radius) const -> QVector<qsizetype>
+{
+    if (!position.isValid() || !radius.isFinite() || m_points.isEmpty())
+    {
+        return {};
+    }
+    auto query = toPoint(position);
+
+    // Convert the great-circle radius into a squared chord length on the unit
+    // sphere
+    auto angle = qMin(radius.toM()/earthRadiusInM, M_PI);
+    auto chord = 2.0*qSin(angle/2.0);
+    auto maxDist = chord*chord;
+
+    QVector<std::pair<double, qsizetype>> found;
+    auto consider = [&](const Point& point) {
+        auto dist = squaredDistance(query, point.xyz);
+        if (dist < maxDist)
+        {
+            found.append({dist, point.index});
+        }
+    };
+
+    struct Range {
+        qsizetype begin;
+        qsizetype end;
+        int axis;
+    };
+    QVector<Range> stack;
+    stack.append({0, m_points.size(), 0});
+    while (!stack.isEmpty())
+    {
+        auto range = stack.takeLast();
+        if (range.end-range.begin <= leafSize)
+        {
+            for(auto i=range.begin; i<range.end; i++)
+            {
+                consider(m_points[i]);
+            }
+            continue;
+        }
+
+        auto mid = range.begin + (range.end-range.begin)/2;
+        consider(m_points[mid]);
+
+        auto diff = query[range.axis] - m_points[mid].xyz[range.axis];
+        auto nextAxis = (range.axis+1)%3;
+        if ((diff < 0) || (diff*diff < maxDist))
+        {
+            stack.append({range.begin, mid, nextAxis});
+        }
+        if ((diff >= 0) || (diff*diff < maxDist))
+        {
+            stack.append({mid+1, range.end, nextAxis});
+        }
+    }
+
+    std::sort(found.begin(), found.end());
+    QVector<qsizetype> result;
+    result.reserve(found.size());
+    for(const auto& entry : found)
+    {
+        result.append(entry.second);
+    }
+    return result;
+}
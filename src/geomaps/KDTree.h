@@ -0,0 +1,123 @@
+/***************************************************************************
+ *   Copyright (C) 2023 by Stefan Kebekus                                  *
+ *   stefan.kebekus@gmail.com                                              *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 3 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, write to the                         *
+ *   Free Software Foundation, Inc.,                                       *
+ *   59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.             *
+ ***************************************************************************/
+
+
+#pragma once
+
+#include <QGeoCoordinate>
+#include <QVector>
+#include <array>
+#include <functional>
+
+#include "units/Distance.h"
+
+namespace GeoMaps {
+
+/*! \brief Static spatial index for points on the earth's surface
+ *
+ *  This class implements a k-d tree over a list of coordinates. To avoid
+ *  problems at the poles and at the antimeridian, coordinates are mapped to
+ *  points on the three-dimensional unit sphere. Straight-line distances between
+ *  these points are monotone in the great-circle distance, so that queries give
+ *  the same results as comparisons of QGeoCoordinate::distanceTo(), but without
+ *  evaluating trigonometric functions for every point.
+ *
+ *  The tree is built once, in the constructor, and cannot be modified
+ *  afterwards.  Query results are indices into the list of coordinates that
+ *  was handed over to the constructor. Invalid coordinates are never returned.
+ *
+ *  Instances of this class are immutable and can therefore be used from
+ *  several threads at the same time.
+ */
+
+class KDTree {
+
+public:
+    /*! \brief Constructs an empty tree */
+    KDTree() = default;
+
+    /*! \brief Constructs a tree from a list of coordinates
+     *
+     *  @param coordinates List of coordinates. The query methods of this class
+     *  return indices into this list.
+     */
+    explicit KDTree(const QVector<QGeoCoordinate>& coordinates);
+
+    /*! \brief Check if tree is empty
+     *
+     *  @returns True if the tree does not contain any points
+     */
+    [[nodiscard]] auto isEmpty() const -> bool
+    {
+        return m_points.isEmpty();
+    }
+
+    /*! \brief Find the points closest to a given position
+     *
+     *  @param position Position
+     *
+     *  @param k Maximal number of points to return
+     *
+     *  @param filter Optional filter. If set, only points whose index is
+     *  accepted by the filter are considered.
+     *
+     *  @returns Indices of the k points closest to the position, sorted by
+     *  distance. The list may contain fewer than k items.
+     */
+    [[nodiscard]] auto nearest(const QGeoCoordinate& position, qsizetype k, const std::function<bool(qsizetype)>& filter = {}) const -> QVector<qsizetype>;
+
+    /*! \brief Find all points within a given distance of a position
+     *
+     *  @param position Position
+     *
+     *  @param radius Search radius
+     *
+     *  @returns Indices of all points whose distance to the position is less
+     *  than radius, sorted by distance
+     */
+    [[nodiscard]] auto withinRadius(const QGeoCoordinate& position, Units::Distance radius) const -> QVector<qsizetype>;
+
+private:
+    // Point on the unit sphere, together with the index of the coordinate in
+    // the list given to the constructor
+    struct Point {
+        std::array<double, 3> xyz {0.0, 0.0, 0.0};
+        qsizetype index {0};
+    };
+
+    // Number of points below which a subtree is not split any further
+    static constexpr qsizetype leafSize = 8;
+
+    // Maps a coordinate to the unit sphere
+    static auto toPoint(const QGeoCoordinate& coordinate) -> std::array<double, 3>;
+
+    // Squared straight-line distance between two points
+    static auto squaredDistance(const std::array<double, 3>& a, const std::array<double, 3>& b) -> double;
+
+    // Sorts m_points[begin, end) into a balanced tree, splitting along axis
+    void build(qsizetype begin, qsizetype end, int axis);
+
+    // Points, sorted so that they form an implicit balanced tree. The subtree
+    // for the range [begin, end) has its splitting point at the middle of the
+    // range.
+    QVector<Point> m_points;
+};
+
+} // namespace GeoMaps
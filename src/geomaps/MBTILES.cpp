@@ -20,19 +20,16 @@
 
 #include <QSqlDatabase>
 #include <QSqlQuery>
+#include <QThread>
 #include <QVariant>
+#include <QtMath>
 
 #include "geomaps/MBTILES.h"
 
 GeoMaps::MBTILES::MBTILES(const QString& fileName, QObject *parent)
     : QObject(parent), m_fileName(fileName)
 {
-    m_databaseConnectionName = QStringLiteral("GeoMaps::MBTILES::format %1,%2").arg(fileName).arg((quintptr)this);
-    auto m_dataBase = QSqlDatabase::addDatabase(QStringLiteral("QSQLITE"), m_databaseConnectionName);
-    m_dataBase.setDatabaseName(fileName);
-    m_dataBase.open();
-
-    QSqlQuery query(m_dataBase);
+    QSqlQuery query(QSqlDatabase::database(connection().name));
     if (query.exec(QStringLiteral("select name, value from metadata;")))
     {
         while(query.next())
@@ -42,17 +39,27 @@ GeoMaps::MBTILES::MBTILES(const QString& fileName, QObject *parent)
             m_metadata.insert(key, value);
         }
     }
+    computeCoverage();
 }
 
 GeoMaps::MBTILES::~MBTILES()
 {
-    QSqlDatabase::database(m_databaseConnectionName).close();
-    QSqlDatabase::removeDatabase(m_databaseConnectionName);
+    // No thread uses this instance anymore, so the connections of all threads
+    // are closed here. Waiting for the threads to finish is not an option,
+    // because worker threads of thread pools often live much longer than
+    // this instance, and open connections keep the files mapped and locked.
+    QMutexLocker locker(&m_connections->mutex);
+    auto threads = m_connections->byThread.keys();
+    locker.unlock();
+    foreach(auto thread, threads)
+    {
+        removeConnection(*m_connections, thread);
+    }
 }
 
 auto GeoMaps::MBTILES::attribution() -> QString
 {
-    auto m_dataBase = QSqlDatabase::database(m_databaseConnectionName);
+    auto m_dataBase = QSqlDatabase::database(connection().name);
     QSqlQuery query(m_dataBase);
     if (query.exec(QStringLiteral("select name, value from metadata where name='attribution';")))
     {
@@ -66,7 +73,7 @@ auto GeoMaps::MBTILES::attribution() -> QString
 
 auto GeoMaps::MBTILES::format() -> GeoMaps::MBTILES::Format
 {
-    auto m_dataBase = QSqlDatabase::database(m_databaseConnectionName);
+    auto m_dataBase = QSqlDatabase::database(connection().name);
     QSqlQuery query(m_dataBase);
     if (query.exec(QStringLiteral("select name, value from metadata where name='format';")))
     {
@@ -91,7 +98,7 @@ auto GeoMaps::MBTILES::info() -> QString
     QString result;
 
     // Read metadata from database
-    auto m_dataBase = QSqlDatabase::database(m_databaseConnectionName);
+    auto m_dataBase = QSqlDatabase::database(connection().name);
     QSqlQuery query(m_dataBase);
     QString intResult;
     if (query.exec(QStringLiteral("select name, value from metadata;")))
@@ -118,17 +125,140 @@ auto GeoMaps::MBTILES::info() -> QString
 
 auto GeoMaps::MBTILES::tile(int zoom, int x, int y) -> QByteArray
 {
-    auto m_dataBase = QSqlDatabase::database(m_databaseConnectionName);
-    QSqlQuery query(m_dataBase);
+    auto query = connection().tileQuery;
+    if (query.isNull())
+    {
+        return {};
+    }
+
     auto yflipped = (1<<zoom)-1-y;
-    auto queryString = QStringLiteral("select tile_data from tiles where zoom_level=%1 and tile_row=%3 and tile_column=%2;").arg(zoom).arg(x).arg(yflipped);
-    if (query.exec(queryString))
+    query->bindValue(0, zoom);
+    query->bindValue(1, x);
+    query->bindValue(2, yflipped);
+    QByteArray result;
+    if (query->exec() && query->next())
     {
-        if (query.first())
+        result = query->value(0).toByteArray();
+    }
+    query->finish();
+    return result;
+}
+
+
+void GeoMaps::MBTILES::computeCoverage()
+{
+    bool ok = false;
+    auto minZoom = m_metadata.value(QStringLiteral("minzoom")).toInt(&ok);
+    if (!ok)
+    {
+        minZoom = 0;
+    }
+    auto maxZoom = m_metadata.value(QStringLiteral("maxzoom")).toInt(&ok);
+    if (!ok)
+    {
+        maxZoom = maxSupportedZoom;
+    }
+    minZoom = qBound(0, minZoom, maxSupportedZoom);
+    maxZoom = qBound(0, maxZoom, maxSupportedZoom);
+
+    // Bounds are given as "left,bottom,right,top", in WGS84 degrees
+    double west = -180.0;
+    double south = -85.0511287798;
+    double east = 180.0;
+    double north = 85.0511287798;
+    auto bounds = m_metadata.value(QStringLiteral("bounds")).split(',');
+    if (bounds.size() == 4)
+    {
+        bool okWest = false;
+        bool okSouth = false;
+        bool okEast = false;
+        bool okNorth = false;
+        auto _west = bounds[0].toDouble(&okWest);
+        auto _south = bounds[1].toDouble(&okSouth);
+        auto _east = bounds[2].toDouble(&okEast);
+        auto _north = bounds[3].toDouble(&okNorth);
+        if (okWest && okSouth && okEast && okNorth && (_west <= _east) && (_south <= _north))
         {
-            return query.value(0).toByteArray();
+            west = qBound(-180.0, _west, 180.0);
+            east = qBound(-180.0, _east, 180.0);
+            south = qBound(-85.0511287798, _south, 85.0511287798);
+            north = qBound(-85.0511287798, _north, 85.0511287798);
         }
     }
 
-    return {};
+    m_coverage.clear();
+    m_coverage.resize(maxZoom+1);
+    for(int zoom = minZoom; zoom <= maxZoom; zoom++)
+    {
+        auto numTiles = 1<<zoom;
+        auto tileX = [numTiles](double longitude) {
+            return qBound(0, qFloor((longitude+180.0)/360.0*numTiles), numTiles-1);
+        };
+        auto tileY = [numTiles](double latitude) {
+            return qBound(0, qFloor((1.0 - asinh(tan(qDegreesToRadians(latitude)))/M_PI)/2.0*numTiles), numTiles-1);
+        };
+        m_coverage[zoom] = QRect(QPoint(tileX(west), tileY(north)), QPoint(tileX(east), tileY(south)));
+    }
+}
+
+
+auto GeoMaps::MBTILES::connection() -> Connection
+{
+    auto* thread = QThread::currentThread();
+
+    QMutexLocker locker(&m_connections->mutex);
+    auto iterator = m_connections->byThread.constFind(thread);
+    if (iterator != m_connections->byThread.constEnd())
+    {
+        return *iterator;
+    }
+
+    // The address of m_connections is used rather than the address of this
+    // instance, because it remains in use until all connections are closed.
+    Connection result;
+    result.name = QStringLiteral("GeoMaps::MBTILES %1,%2,%3").arg(m_fileName).arg((quintptr)m_connections.data()).arg((quintptr)thread);
+    auto dataBase = QSqlDatabase::addDatabase(QStringLiteral("QSQLITE"), result.name);
+    dataBase.setDatabaseName(m_fileName);
+    dataBase.setConnectOptions(QStringLiteral("QSQLITE_OPEN_READONLY"));
+    if (dataBase.open())
+    {
+        // Memory-map up to 256 MB of the database file. This avoids copying
+        // tile data through the SQLite page cache.
+        QSqlQuery pragma(dataBase);
+        pragma.exec(QStringLiteral("PRAGMA mmap_size=268435456;"));
+
+        result.tileQuery = QSharedPointer<QSqlQuery>(new QSqlQuery(dataBase));
+        result.tileQuery->setForwardOnly(true);
+        if (!result.tileQuery->prepare(QStringLiteral("select tile_data from tiles where zoom_level=? and tile_column=? and tile_row=?;")))
+        {
+            result.tileQuery.clear();
+        }
+    }
+
+    // Close the connection when the thread finishes, if this instance still
+    // exists then. The signal is emitted from the finishing thread, so the
+    // connection is closed in the thread that used it. The handler does not
+    // depend on this instance, because the destructor might run at the same
+    // time.
+    if (thread != this->thread())
+    {
+        result.finishedHandler = connect(thread, &QThread::finished, thread,
+                                         [connections = m_connections, thread]() { removeConnection(*connections, thread); },
+                                         static_cast<Qt::ConnectionType>(Qt::DirectConnection | Qt::SingleShotConnection));
+    }
+    m_connections->byThread.insert(thread, result);
+    return result;
+}
+
+
+void GeoMaps::MBTILES::removeConnection(Connections& connections, QThread* thread)
+{
+    QMutexLocker locker(&connections.mutex);
+    auto connection = connections.byThread.take(thread);
+    QObject::disconnect(connection.finishedHandler);
+    connection.tileQuery.clear();
+    if (!connection.name.isEmpty())
+    {
+        QSqlDatabase::removeDatabase(connection.name);
+    }
 }
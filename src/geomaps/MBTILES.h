@@ -20,7 +20,15 @@
 
 #pragma once
 
+#include <QHash>
 #include <QMap>
+#include <QMutex>
+#include <QRect>
+#include <QSharedPointer>
+#include <QVector>
+
+class QSqlQuery;
+class QThread;
 
 namespace GeoMaps
 {
@@ -30,6 +38,12 @@ namespace GeoMaps
    *  MBTILES contain tiled map data. Internally, MBTILES are SQLite databases
    *  whose schema is specified here: https://github.com/mapbox/mbtiles-spec
    *  This class handles MBTILES and allows easy access to the data.
+   *
+   *  The database is opened read-only, with memory-mapped I/O. Every thread
+   *  that accesses an instance of this class gets its own database connection,
+   *  with a prepared statement for tile queries. The connection is closed when
+   *  the thread finishes. The method tile() can therefore be called from
+   *  several threads at the same time.
    */
 
   class MBTILES : public QObject
@@ -88,6 +102,8 @@ namespace GeoMaps
     [[nodiscard]] QString info();
 
     /*! \brief Retrieve tile from an MBTILES file
+     *
+     *  This method is thread-safe.
      *
      *  @param zoom Zoom level of the tile
      *
@@ -100,6 +116,31 @@ namespace GeoMaps
      */
     [[nodiscard]] QByteArray tile(int zoom, int x, int y);
 
+    /*! \brief Check if the MBTILES file can contain a given tile
+     *
+     *  This method uses the metadata entries "bounds", "minzoom" and
+     *  "maxzoom", which are read when the file is opened, to decide quickly
+     *  if a tile can possibly be contained in the file. If the metadata does
+     *  not specify bounds or zoom range, the file is assumed to cover the
+     *  whole world, or all zoom levels.  This method is thread-safe.
+     *
+     *  @param zoom Zoom level of the tile
+     *
+     *  @param x x-Coordinate of the tile
+     *
+     *  @param y y-Coordinate of the tile, counted from the north, as in tile()
+     *
+     *  @returns False if the file certainly does not contain the tile
+     */
+    [[nodiscard]] auto covers(int zoom, int x, int y) const -> bool
+    {
+      if ((zoom < 0) || (zoom >= m_coverage.size()))
+      {
+        return false;
+      }
+      return m_coverage[zoom].contains(x, y);
+    }
+
     /*! \brief Retrieve metadata of the MBTILES file
      *
      *  MBTILES files contain metadata, in the form of a list of key/value
@@ -128,10 +169,51 @@ namespace GeoMaps
     // Name of the MBTILES file
     QString m_fileName;
 
-    // Name of the data base connection. This name is unique to each instance of
-    // this class, and should therefore not be copied.
-    QString m_databaseConnectionName;
+    // Database connection for one thread, together with a prepared statement
+    // for tile queries. The name of the connection is unique to each instance
+    // of this class and each thread, and should therefore not be copied. The
+    // pointer tileQuery is null if the database could not be opened. The
+    // member finishedHandler is the handler that closes the connection when
+    // the thread finishes, if there is one.
+    struct Connection {
+        QString name;
+        QSharedPointer<QSqlQuery> tileQuery;
+        QMetaObject::Connection finishedHandler;
+    };
+
+    // Connections, accessible by thread. Access is protected by the mutex.
+    struct Connections {
+        QMutex mutex;
+        QHash<QThread*, Connection> byThread;
+    };
+
+    // Returns the connection for the current thread. If there is none, a new
+    // connection is opened. The connection must only be used in the current
+    // thread.
+    auto connection() -> Connection;
+
+    // Closes the connection of the given thread and disconnects its finished
+    // handler. The thread must no longer use the connection. If the
+    // connection is already closed, this method does nothing.
+    static void removeConnection(Connections& connections, QThread* thread);
+
+    // Connections of all threads. The handlers that close connections when
+    // their threads finish share ownership, so that a handler that runs
+    // while this instance is destroyed does not access freed memory.
+    QSharedPointer<Connections> m_connections {new Connections};
+
     QMap<QString, QString> m_metadata;
+
+    // Computes m_coverage from the metadata
+    void computeCoverage();
+
+    // Highest zoom level considered by covers(), if the metadata does not
+    // specify a maximal zoom level
+    static constexpr int maxSupportedZoom = 24;
+
+    // For every zoom level, the range of tiles that the file can contain.
+    // Empty rectangles for zoom levels that the file does not contain.
+    QVector<QRect> m_coverage;
   };
 
 } // namespace GeoMaps
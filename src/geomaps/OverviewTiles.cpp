@@ -0,0 +1,536 @@
+/***************************************************************************
+ *   Copyright (C) 2023 by Stefan Kebekus                                  *
+ *   stefan.kebekus@gmail.com                                              *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 3 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, write to the                         *
+ *   Free Software Foundation, Inc.,                                       *
+ *   59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.             *
+ ***************************************************************************/
+
+#include <QBuffer>
+#include <QCryptographicHash>
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QImage>
+#include <QImageWriter>
+#include <QPainter>
+#include <QRectF>
+#include <QSet>
+#include <QSharedPointer>
+#include <QSqlDatabase>
+#include <QSqlQuery>
+#include <QStandardPaths>
+#include <QThread>
+#include <QVariant>
+#include <QtMath>
+#include <algorithm>
+
+#include "geomaps/OverviewTiles.h"
+
+
+namespace {
+
+// SQLite database, with a connection that is private to the current thread
+// and closed on destruction. All queries on the database must be destroyed
+// before the database.
+class Database {
+public:
+    Database(const QString& fileName, bool readOnly)
+        : m_name(QStringLiteral("GeoMaps::OverviewTiles %1,%2").arg(fileName).arg((quintptr)QThread::currentThread()))
+    {
+        auto dataBase = QSqlDatabase::addDatabase(QStringLiteral("QSQLITE"), m_name);
+        dataBase.setDatabaseName(fileName);
+        if (readOnly)
+        {
+            dataBase.setConnectOptions(QStringLiteral("QSQLITE_OPEN_READONLY"));
+        }
+        dataBase.open();
+    }
+
+    ~Database()
+    {
+        {
+            auto dataBase = QSqlDatabase::database(m_name, false);
+            dataBase.close();
+        }
+        QSqlDatabase::removeDatabase(m_name);
+    }
+
+    [[nodiscard]] auto get() const -> QSqlDatabase
+    {
+        return QSqlDatabase::database(m_name, false);
+    }
+
+    [[nodiscard]] auto metaData() const -> QMap<QString, QString>
+    {
+        QMap<QString, QString> result;
+        QSqlQuery query(get());
+        if (query.exec(QStringLiteral("select name, value from metadata;")))
+        {
+            while(query.next())
+            {
+                result.insert(query.value(0).toString(), query.value(1).toString());
+            }
+        }
+        return result;
+    }
+
+    // Reads a tile. The y coordinate is counted from the north.
+    [[nodiscard]] auto tile(int zoom, int x, int y) const -> QByteArray
+    {
+        QSqlQuery query(get());
+        query.prepare(QStringLiteral("select tile_data from tiles where zoom_level=? and tile_column=? and tile_row=?;"));
+        query.addBindValue(zoom);
+        query.addBindValue(x);
+        query.addBindValue((1<<zoom)-1-y);
+        if (query.exec() && query.next())
+        {
+            return query.value(0).toByteArray();
+        }
+        return {};
+    }
+
+    // Lists the tiles of a zoom level. The y coordinates are counted from the
+    // north.
+    [[nodiscard]] auto tiles(int zoom) const -> QSet<QPair<int, int>>
+    {
+        QSet<QPair<int, int>> result;
+        QSqlQuery query(get());
+        query.prepare(QStringLiteral("select tile_column, tile_row from tiles where zoom_level=?;"));
+        query.addBindValue(zoom);
+        if (query.exec())
+        {
+            while(query.next())
+            {
+                result.insert({query.value(0).toInt(), (1<<zoom)-1-query.value(1).toInt()});
+            }
+        }
+        return result;
+    }
+
+    // Writes a tile. The y coordinate is counted from the north.
+    auto insertTile(int zoom, int x, int y, const QByteArray& data) const -> bool
+    {
+        QSqlQuery query(get());
+        query.prepare(QStringLiteral("insert into tiles (zoom_level, tile_column, tile_row, tile_data) values (?, ?, ?, ?);"));
+        query.addBindValue(zoom);
+        query.addBindValue(x);
+        query.addBindValue((1<<zoom)-1-y);
+        query.addBindValue(data);
+        return query.exec();
+    }
+
+private:
+    Q_DISABLE_COPY_MOVE(Database)
+    QString m_name;
+};
+
+
+// Terrarium encoding: elevation = R*256 + G + B/256 - 32768
+auto terrariumElevation(QRgb pixel) -> double
+{
+    return qRed(pixel)*256.0 + qGreen(pixel) + qBlue(pixel)/256.0 - 32768.0;
+}
+
+auto terrariumPixel(double elevation) -> QRgb
+{
+    auto value = qBound(0.0, elevation+32768.0, 65535.99);
+    auto integer = qFloor(value);
+    return qRgb(integer/256, integer%256, qFloor((value-integer)*256.0));
+}
+
+
+// Encodes an image in the given format
+auto encode(const QImage& image, const QByteArray& format) -> QByteArray
+{
+    QByteArray result;
+    QBuffer buffer(&result);
+    buffer.open(QIODevice::WriteOnly);
+    if (!image.save(&buffer, format.constData(), (format == "jpg") ? 90 : -1))
+    {
+        return {};
+    }
+    return result;
+}
+
+
+// Checks if a pixel belongs to the background of a tile. Outside the region
+// they cover, raster maps are transparent or filled with white. JPEG
+// compression leaves some noise in the white fill.
+auto isBackground(QRgb pixel) -> bool
+{
+    return (qAlpha(pixel) < 8) || ((qRed(pixel) >= 248) && (qGreen(pixel) >= 248) && (qBlue(pixel) >= 248));
+}
+
+
+// Merges tiles of the same area from different files. Every pixel is taken
+// from the first tile where it is not background, so that opaque tiles do
+// not hide each other. Where all tiles show background, the pixel of the
+// first tile is used. Tiles whose size differs from the first are ignored.
+auto merge(const QVector<QByteArray>& tiles) -> QImage
+{
+    QImage result;
+    foreach(auto tile, tiles)
+    {
+        QImage image;
+        if (!image.loadFromData(tile))
+        {
+            continue;
+        }
+        image.convertTo(QImage::Format_ARGB32);
+        if (result.isNull())
+        {
+            result = image;
+            continue;
+        }
+        if (image.size() != result.size())
+        {
+            continue;
+        }
+        for(int row=0; row<result.height(); row++)
+        {
+            auto* target = reinterpret_cast<QRgb*>(result.scanLine(row));
+            const auto* source = reinterpret_cast<const QRgb*>(image.constScanLine(row));
+            for(int column=0; column<result.width(); column++)
+            {
+                if (isBackground(target[column]) && !isBackground(source[column]))
+                {
+                    target[column] = source[column];
+                }
+            }
+        }
+    }
+    return result;
+}
+
+
+// Computes a tile from its four children, which are given in the order
+// north-west, north-east, south-west, south-east. Missing children are given
+// as empty arrays.
+auto downsample(const QVector<QByteArray>& children, GeoMaps::OverviewTiles::Encoding encoding, bool opaque) -> QImage
+{
+    QVector<QImage> images(4);
+    int size = 0;
+    for(int quadrant=0; quadrant<4; quadrant++)
+    {
+        if (images[quadrant].loadFromData(children[quadrant]) && (size == 0))
+        {
+            size = images[quadrant].width();
+        }
+    }
+    if (size < 2)
+    {
+        return {};
+    }
+
+    if (encoding == GeoMaps::OverviewTiles::Encoding::Image)
+    {
+        QImage canvas(2*size, 2*size, QImage::Format_ARGB32_Premultiplied);
+        canvas.fill(opaque ? Qt::white : Qt::transparent);
+        QPainter painter(&canvas);
+        for(int quadrant=0; quadrant<4; quadrant++)
+        {
+            if (!images[quadrant].isNull())
+            {
+                painter.drawImage(QRect((quadrant%2)*size, (quadrant/2)*size, size, size), images[quadrant]);
+            }
+        }
+        painter.end();
+        return canvas.scaled(size, size, Qt::IgnoreAspectRatio, Qt::SmoothTransformation);
+    }
+
+    // Terrain: average the elevations of 2x2 blocks of pixels. Image
+    // scaling would interpolate the color channels separately and destroy the
+    // encoding. Missing children are taken to be at sea level.
+    QImage result(size, size, QImage::Format_RGB32);
+    auto half = size/2;
+    for(int quadrant=0; quadrant<4; quadrant++)
+    {
+        auto child = images[quadrant];
+        auto valid = !child.isNull() && (child.width() == size) && (child.height() == size);
+        if (valid)
+        {
+            child.convertTo(QImage::Format_RGB32);
+        }
+        for(int row=0; row<half; row++)
+        {
+            auto* target = reinterpret_cast<QRgb*>(result.scanLine((quadrant/2)*half+row)) + (quadrant%2)*half;
+            if (!valid)
+            {
+                std::fill(target, target+half, terrariumPixel(0.0));
+                continue;
+            }
+            const auto* upper = reinterpret_cast<const QRgb*>(child.constScanLine(2*row));
+            const auto* lower = reinterpret_cast<const QRgb*>(child.constScanLine(2*row+1));
+            for(int column=0; column<half; column++)
+            {
+                auto sum = terrariumElevation(upper[2*column]) + terrariumElevation(upper[2*column+1])
+                        + terrariumElevation(lower[2*column]) + terrariumElevation(lower[2*column+1]);
+                target[column] = terrariumPixel(sum/4.0);
+            }
+        }
+    }
+    return result;
+}
+
+
+// Writes the tiles of the overview. The top level merges the tiles of all
+// source files, the lower levels are downsampled from the level above.
+// Returns false if the flag canceled was set before all tiles were written.
+auto fillTiles(const QVector<QSharedPointer<Database>>& sources, const Database& target, int topZoom, GeoMaps::OverviewTiles::Encoding encoding, const QByteArray& format, const QAtomicInt& canceled) -> bool
+{
+    auto opaque = (format == "jpg") || (format == "jpeg");
+
+    QSet<QPair<int, int>> tiles;
+    foreach(auto source, sources)
+    {
+        tiles.unite(source->tiles(topZoom));
+    }
+    foreach(auto tile, tiles)
+    {
+        // Merging the top level takes the longest, so the flag is also
+        // checked here
+        if (canceled.loadRelaxed() != 0)
+        {
+            return false;
+        }
+
+        QVector<QByteArray> data;
+        foreach(auto source, sources)
+        {
+            auto sourceData = source->tile(topZoom, tile.first, tile.second);
+            if (!sourceData.isEmpty())
+            {
+                data.append(sourceData);
+            }
+        }
+
+        // Tiles found in only one file are copied verbatim. Terrain tiles of
+        // different files are expected to agree.
+        QByteArray mergedData;
+        if ((data.size() == 1) || ((encoding == GeoMaps::OverviewTiles::Encoding::Terrarium) && !data.isEmpty()))
+        {
+            mergedData = data[0];
+        }
+        else if (data.size() > 1)
+        {
+            mergedData = encode(merge(data), format);
+        }
+        if (!mergedData.isEmpty())
+        {
+            target.insertTile(topZoom, tile.first, tile.second, mergedData);
+        }
+    }
+
+    for(auto zoom = topZoom-1; zoom >= 0; zoom--)
+    {
+        if (canceled.loadRelaxed() != 0)
+        {
+            return false;
+        }
+
+        QSet<QPair<int, int>> parents;
+        foreach(auto tile, tiles)
+        {
+            parents.insert({tile.first/2, tile.second/2});
+        }
+        foreach(auto parent, parents)
+        {
+            QVector<QByteArray> children;
+            for(int quadrant=0; quadrant<4; quadrant++)
+            {
+                children.append(target.tile(zoom+1, 2*parent.first+quadrant%2, 2*parent.second+quadrant/2));
+            }
+            auto image = downsample(children, encoding, opaque);
+            if (!image.isNull())
+            {
+                target.insertTile(zoom, parent.first, parent.second, encode(image, format));
+            }
+        }
+        tiles = parents;
+    }
+    return true;
+}
+
+
+// Writes the metadata of the overview. The bounds are omitted if they are
+// null.
+void writeMetaData(const Database& target, const QByteArray& format, int topZoom, const QRectF& bounds)
+{
+    QMap<QString, QString> metaData;
+    metaData.insert(QStringLiteral("name"), QStringLiteral("Overview"));
+    metaData.insert(QStringLiteral("type"), QStringLiteral("baselayer"));
+    metaData.insert(QStringLiteral("format"), QString::fromLatin1(format));
+    metaData.insert(QStringLiteral("minzoom"), QStringLiteral("0"));
+    metaData.insert(QStringLiteral("maxzoom"), QString::number(topZoom));
+    if (!bounds.isNull())
+    {
+        // Bounds are given as "left,bottom,right,top"
+        metaData.insert(QStringLiteral("bounds"), QStringLiteral("%1,%2,%3,%4").arg(bounds.left()).arg(bounds.top()).arg(bounds.right()).arg(bounds.bottom()));
+    }
+
+    QSqlQuery query(target.get());
+    query.prepare(QStringLiteral("insert into metadata (name, value) values (?, ?);"));
+    for(auto iterator = metaData.constBegin(); iterator != metaData.constEnd(); iterator++)
+    {
+        query.addBindValue(iterator.key());
+        query.addBindValue(iterator.value());
+        query.exec();
+    }
+}
+
+} // namespace
+
+
+auto GeoMaps::OverviewTiles::directory() -> QString
+{
+    return QStandardPaths::writableLocation(QStandardPaths::CacheLocation)+u"/overviews"_qs;
+}
+
+
+auto GeoMaps::OverviewTiles::fileName(const QStringList& sourceFileNames) -> QString
+{
+    auto sortedFileNames = sourceFileNames;
+    sortedFileNames.sort();
+
+    QCryptographicHash hash(QCryptographicHash::Sha1);
+    hash.addData(QStringLiteral(GIT_COMMIT).toUtf8());
+    foreach(auto sourceFileName, sortedFileNames)
+    {
+        QFileInfo info(sourceFileName);
+        hash.addData(sourceFileName.toUtf8());
+        hash.addData(QByteArray::number(info.size()));
+        hash.addData(QByteArray::number(info.lastModified().toMSecsSinceEpoch()));
+    }
+    return directory()+'/'+QString::fromLatin1(hash.result().toHex())+u".mbtiles"_qs;
+}
+
+
+auto GeoMaps::OverviewTiles::build(const QStringList& sourceFileNames, Encoding encoding, const QAtomicInt& canceled) -> bool
+{
+    if (sourceFileNames.isEmpty())
+    {
+        return false;
+    }
+    QDir().mkpath(directory());
+    auto targetFileName = fileName(sourceFileNames);
+    auto temporaryFileName = targetFileName+u".tmp"_qs;
+    QFile::remove(temporaryFileName);
+
+    bool success = false;
+    {
+        //
+        // Open source files and read their metadata. The top level of the
+        // overview is the highest zoom level that all files provide.
+        //
+        QVector<QSharedPointer<Database>> sources;
+        QByteArray format;
+        int topZoom = maxZoom;
+        QRectF bounds;
+        bool boundsValid = true;
+        foreach(auto sourceFileName, sourceFileNames)
+        {
+            QSharedPointer<Database> source(new Database(sourceFileName, true));
+            if (!source->get().isOpen())
+            {
+                continue;
+            }
+            auto metaData = source->metaData();
+            bool ok = false;
+            auto sourceMaxZoom = metaData.value(QStringLiteral("maxzoom")).toInt(&ok);
+            if (ok)
+            {
+                topZoom = qMin(topZoom, sourceMaxZoom);
+            }
+            if (format.isEmpty())
+            {
+                format = metaData.value(QStringLiteral("format")).toLatin1();
+            }
+            auto sourceBounds = metaData.value(QStringLiteral("bounds")).split(',');
+            if (sourceBounds.size() == 4)
+            {
+                // Bounds are given as "left,bottom,right,top". In the
+                // rectangle, "top" is the southern edge.
+                QRectF rect(QPointF(sourceBounds[0].toDouble(), sourceBounds[1].toDouble()), QPointF(sourceBounds[2].toDouble(), sourceBounds[3].toDouble()));
+                bounds = bounds.isNull() ? rect : bounds.united(rect);
+            }
+            else
+            {
+                boundsValid = false;
+            }
+            sources.append(source);
+        }
+        if (sources.isEmpty() || (topZoom < 0))
+        {
+            return false;
+        }
+
+        // Terrain data needs lossless compression. Other data is written in
+        // the format of the source files, if possible.
+        if ((encoding == Encoding::Terrarium) || !QImageWriter::supportedImageFormats().contains(format))
+        {
+            format = "png";
+        }
+
+        //
+        // Create target database
+        //
+        Database target(temporaryFileName, false);
+        auto targetDataBase = target.get();
+        bool created = false;
+        {
+            QSqlQuery query(targetDataBase);
+            created = targetDataBase.isOpen()
+                    && query.exec(QStringLiteral("PRAGMA synchronous=OFF;"))
+                    && query.exec(QStringLiteral("create table metadata (name text, value text);"))
+                    && query.exec(QStringLiteral("create table tiles (zoom_level integer, tile_column integer, tile_row integer, tile_data blob);"))
+                    && query.exec(QStringLiteral("create unique index tile_index on tiles (zoom_level, tile_column, tile_row);"));
+        }
+        if (created)
+        {
+            targetDataBase.transaction();
+            if (fillTiles(sources, target, topZoom, encoding, format, canceled))
+            {
+                writeMetaData(target, format, topZoom, boundsValid ? bounds : QRectF());
+                success = targetDataBase.commit();
+            }
+            else
+            {
+                targetDataBase.rollback();
+            }
+        }
+    }
+
+    if (!success)
+    {
+        QFile::remove(temporaryFileName);
+        return false;
+    }
+    QFile::remove(targetFileName);
+    return QFile::rename(temporaryFileName, targetFileName);
+}
+
+
+void GeoMaps::OverviewTiles::removeUnused(const QStringList& fileNamesInUse)
+{
+    QDir dir(directory());
+    foreach(auto entry, dir.entryInfoList({QStringLiteral("*.mbtiles")}, QDir::Files))
+    {
+        if (!fileNamesInUse.contains(entry.absoluteFilePath()))
+        {
+            QFile::remove(entry.absoluteFilePath());
+        }
+    }
+}
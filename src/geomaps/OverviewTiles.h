@@ -0,0 +1,103 @@
+/***************************************************************************
+ *   Copyright (C) 2023 by Stefan Kebekus                                  *
+ *   stefan.kebekus@gmail.com                                              *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 3 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, write to the                         *
+ *   Free Software Foundation, Inc.,                                       *
+ *   59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.             *
+ ***************************************************************************/
+
+#pragma once
+
+#include <QAtomicInt>
+#include <QStringList>
+
+namespace GeoMaps {
+
+/*! \brief Merged overview tiles for sets of raster MBTILES files
+ *
+ *  Raster maps and terrain maps are distributed as one MBTILES file per
+ *  region. At low zoom levels, a single tile spans several regions, but the
+ *  TileServer can serve it only from one of the files. This class builds a
+ *  separate MBTILES database with overview tiles for a set of files. The top
+ *  level of the overview merges the tiles of all files, and every lower level
+ *  is computed by downsampling the level above, down to zoom level 0.
+ *
+ *  Image tiles are merged pixel by pixel: every pixel is taken from the first
+ *  file where it is not background, that is, neither transparent nor white.
+ *  Where the regions of two files overlap and both have data, the first file
+ *  wins.
+ *
+ *  Terrain tiles in "terrarium" encoding are downsampled by averaging the
+ *  decoded elevations, so that the encoding stays intact.
+ *
+ *  The overview databases are kept in the cache directory. Their names depend
+ *  on the names, sizes and modification times of the source files, so that an
+ *  overview is never used for the wrong data. All methods of this class are
+ *  reentrant.
+ */
+
+class OverviewTiles {
+
+public:
+    /*! \brief Kind of data in the source files */
+    enum class Encoding {
+        /*! \brief Images, such as raster maps */
+        Image,
+
+        /*! \brief Terrain elevation in "terrarium" encoding */
+        Terrarium
+    };
+
+    /*! \brief Highest zoom level of the overviews */
+    static constexpr int maxZoom = 7;
+
+    /*! \brief Name of the overview database for a set of files
+     *
+     *  @param sourceFileNames Names of MBTILES files with raster data
+     *
+     *  @returns Name of the overview database. The file need not exist.
+     */
+    static auto fileName(const QStringList& sourceFileNames) -> QString;
+
+    /*! \brief Build overview database
+     *
+     *  This method builds the overview database for a set of files and saves
+     *  it under the name fileName(sourceFileNames). The database is written
+     *  to a temporary file first, so that incomplete databases are never
+     *  seen. Building takes a while and should be done in a separate thread.
+     *
+     *  @param sourceFileNames Names of MBTILES files with raster data
+     *
+     *  @param encoding Kind of data in the source files
+     *
+     *  @param canceled Flag that is checked while tiles are written. If it is
+     *  set to a non-zero value, the build stops and no database is written.
+     *
+     *  @returns True on success
+     */
+    static auto build(const QStringList& sourceFileNames, Encoding encoding, const QAtomicInt& canceled) -> bool;
+
+    /*! \brief Delete outdated overview databases
+     *
+     *  @param fileNamesInUse Overview databases that shall be kept
+     */
+    static void removeUnused(const QStringList& fileNamesInUse);
+
+private:
+    // Directory where the overview databases are kept
+    static auto directory() -> QString;
+};
+
+} // namespace GeoMaps
@@ -0,0 +1,164 @@
+/***************************************************************************
+ *   Copyright (C) 2023 by Stefan Kebekus                                  *
+ *   stefan.kebekus@gmail.com                                              *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 3 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, write to the                         *
+ *   Free Software Foundation, Inc.,                                       *
+ *   59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.             *
+ ***************************************************************************/
+
+#include <QtMath>
+#include <numeric>
+
+#include "geomaps/RTree.h"
+
+
+auto GeoMaps::RTree::Box::fromPolygon(const QGeoPolygon& polygon) -> Box
+{
+    Box result;
+    const auto perimeter = polygon.perimeter();
+    if (perimeter.isEmpty())
+    {
+        return result;
+    }
+
+    result.minX = perimeter[0].longitude();
+    result.maxX = result.minX;
+    result.minY = perimeter[0].latitude();
+    result.maxY = result.minY;
+    for(const auto& coordinate : perimeter)
+    {
+        result.minX = qMin(result.minX, coordinate.longitude());
+        result.maxX = qMax(result.maxX, coordinate.longitude());
+        result.minY = qMin(result.minY, coordinate.latitude());
+        result.maxY = qMax(result.maxY, coordinate.latitude());
+    }
+    return result;
+}
+
+
+GeoMaps::RTree::RTree(const QVector<Box>& boxes)
+    : m_numItems(boxes.size())
+{
+    if (m_numItems == 0)
+    {
+        return;
+    }
+
+    //
+    // Sort-Tile-Recursive ordering of the leaves: sort by x coordinate of the
+    // box centers, cut into vertical slices, sort each slice by y coordinate.
+    //
+    m_itemIndices.resize(m_numItems);
+    std::iota(m_itemIndices.begin(), m_itemIndices.end(), 0);
+    auto centerX = [&boxes](qsizetype i) { return boxes[i].minX + boxes[i].maxX; };
+    auto centerY = [&boxes](qsizetype i) { return boxes[i].minY + boxes[i].maxY; };
+    std::sort(m_itemIndices.begin(), m_itemIndices.end(), [&](qsizetype a, qsizetype b) { return centerX(a) < centerX(b); });
+
+    auto numLeafNodes = (m_numItems+nodeCapacity-1)/nodeCapacity;
+    auto numSlices = static_cast<qsizetype>(qCeil(qSqrt(static_cast<double>(numLeafNodes))));
+    auto sliceSize = numSlices*nodeCapacity;
+    for(qsizetype sliceStart = 0; sliceStart < m_numItems; sliceStart += sliceSize)
+    {
+        auto sliceEnd = qMin(sliceStart+sliceSize, m_numItems);
+        std::sort(m_itemIndices.begin()+sliceStart, m_itemIndices.begin()+sliceEnd, [&](qsizetype a, qsizetype b) { return centerY(a) < centerY(b); });
+    }
+
+    //
+    // Build the tree bottom-up. Every node of a level is the bounding box of
+    // nodeCapacity consecutive nodes of the level below.
+    //
+    m_nodes.reserve(m_numItems + m_numItems/(nodeCapacity-1) + 1);
+    for(auto index : std::as_const(m_itemIndices))
+    {
+        m_nodes.append(boxes[index]);
+    }
+    m_levelOffsets << 0 << m_numItems;
+
+    while (m_levelOffsets.last() - m_levelOffsets[m_levelOffsets.size()-2] > 1)
+    {
+        auto levelStart = m_levelOffsets[m_levelOffsets.size()-2];
+        auto levelEnd = m_levelOffsets.last();
+        for(auto childStart = levelStart; childStart < levelEnd; childStart += nodeCapacity)
+        {
+            auto childEnd = qMin(childStart+nodeCapacity, levelEnd);
+            Box parent = m_nodes[childStart];
+            for(auto child = childStart+1; child < childEnd; child++)
+            {
+                const auto& box = m_nodes[child];
+                parent.minX = qMin(parent.minX, box.minX);
+                parent.minY = qMin(parent.minY, box.minY);
+                parent.maxX = qMax(parent.maxX, box.maxX);
+                parent.maxY = qMax(parent.maxY, box.maxY);
+            }
+            m_nodes.append(parent);
+        }
+        m_levelOffsets << m_nodes.size();
+    }
+}
+
+
+template<typename Predicate>
+auto GeoMaps::RTree::searchInternal(Predicate predicate) const -> QVector<qsizetype>
+{
+    QVector<qsizetype> result;
+    if (m_numItems == 0)
+    {
+        return result;
+    }
+
+    // Stack of (position in m_nodes, level) pairs that still need to be
+    // examined. We start with the nodes of the top level.
+    QVector<std::pair<qsizetype, qsizetype>> stack;
+    auto topLevel = m_levelOffsets.size()-2;
+    for(auto position = m_levelOffsets[topLevel]; position < m_levelOffsets[topLevel+1]; position++)
+    {
+        stack.append({position, topLevel});
+    }
+
+    while (!stack.isEmpty())
+    {
+        auto [position, level] = stack.takeLast();
+        if (!predicate(m_nodes[position]))
+        {
+            continue;
+        }
+        if (level == 0)
+        {
+            result.append(m_itemIndices[position]);
+            continue;
+        }
+        auto childStart = m_levelOffsets[level-1] + (position-m_levelOffsets[level])*nodeCapacity;
+        auto childEnd = qMin(childStart+nodeCapacity, m_levelOffsets[level]);
+        for(auto child = childStart; child < childEnd; child++)
+        {
+            stack.append({child, level-1});
+        }
+    }
+
+    std::sort(result.begin(), result.end());
+    return result;
+}
+
+
+auto GeoMaps::RTree::search(double x, double y) const -> QVector<qsizetype>
+{
+    return searchInternal([x, y](const Box& box) { return box.contains(x, y); });
+}
+
+
+auto GeoMaps::RTree::search(const Box& box) const -> QVector<qsizetype>
+{
+    return searchInternal([&box](const Box& node) { return node.intersects(box); });
+}
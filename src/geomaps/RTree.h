@@ -0,0 +1,162 @@
+/***************************************************************************
+ *   Copyright (C) 2023 by Stefan Kebekus                                  *
+ *   stefan.kebekus@gmail.com                                              *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 3 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, write to the                         *
+ *   Free Software Foundation, Inc.,                                       *
+ *   59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.             *
+ ***************************************************************************/
+
+#pragma once
+
+#include <QGeoPolygon>
+#include <QVector>
+
+namespace GeoMaps {
+
+/*! \brief Static spatial index for bounding boxes
+ *
+ *  This class implements a packed R-tree over a list of axis-aligned bounding
+ *  boxes, in the spirit of the "Sort-Tile-Recursive" algorithm. The tree is
+ *  built once, in the constructor, and cannot be modified afterwards. It is
+ *  then able to list all boxes that contain a given point, or intersect a
+ *  given box, in logarithmic time.
+ *
+ *  The class does not know anything about the objects whose bounding boxes it
+ *  stores. Query results are indices into the list of boxes that was handed
+ *  over to the constructor. Coordinates are typically longitude (x) and
+ *  latitude (y), in degrees.
+ *
+ *  Instances of this class are immutable and can therefore be used from
+ *  several threads at the same time.
+ */
+
+class RTree {
+
+public:
+    /*! \brief Axis-aligned bounding box */
+    struct Box {
+        /*! \brief Minimal x coordinate */
+        double minX {0.0};
+
+        /*! \brief Minimal y coordinate */
+        double minY {0.0};
+
+        /*! \brief Maximal x coordinate */
+        double maxX {0.0};
+
+        /*! \brief Maximal y coordinate */
+        double maxY {0.0};
+
+        /*! \brief Check if a point is contained in the box
+         *
+         *  @param x x coordinate of the point
+         *
+         *  @param y y coordinate of the point
+         *
+         *  @returns True if the point is contained in the box or lies on the
+         *  boundary
+         */
+        [[nodiscard]] auto contains(double x, double y) const -> bool
+        {
+            return (x >= minX) && (x <= maxX) && (y >= minY) && (y <= maxY);
+        }
+
+        /*! \brief Check if two boxes intersect
+         *
+         *  @param other Other box
+         *
+         *  @returns True if the boxes have at least one point in common
+         */
+        [[nodiscard]] auto intersects(const Box& other) const -> bool
+        {
+            return (other.minX <= maxX) && (other.maxX >= minX) && (other.minY <= maxY) && (other.maxY >= minY);
+        }
+
+        /*! \brief Bounding box of a polygon
+         *
+         *  The box is computed from the vertices of the polygon, with
+         *  longitude as x and latitude as y coordinate. For polygons that cross
+         *  the antimeridian, this will yield a box that is much too large, but
+         *  never one that is too small.
+         *
+         *  @param polygon Polygon
+         *
+         *  @returns Bounding box of the polygon
+         */
+        static auto fromPolygon(const QGeoPolygon& polygon) -> Box;
+    };
+
+    /*! \brief Constructs an empty tree */
+    RTree() = default;
+
+    /*! \brief Constructs a tree from a list of bounding boxes
+     *
+     *  @param boxes List of bounding boxes. The query methods of this class
+     *  return indices into this list.
+     */
+    explicit RTree(const QVector<Box>& boxes);
+
+    /*! \brief Check if tree is empty
+     *
+     *  @returns True if the tree does not contain any boxes
+     */
+    [[nodiscard]] auto isEmpty() const -> bool
+    {
+        return m_numItems == 0;
+    }
+
+    /*! \brief Find all boxes containing a given point
+     *
+     *  @param x x coordinate of the point
+     *
+     *  @param y y coordinate of the point
+     *
+     *  @returns Indices of all boxes that contain the point, in ascending order
+     */
+    [[nodiscard]] auto search(double x, double y) const -> QVector<qsizetype>;
+
+    /*! \brief Find all boxes intersecting a given box
+     *
+     *  @param box Box
+     *
+     *  @returns Indices of all boxes that intersect the box, in ascending order
+     */
+    [[nodiscard]] auto search(const Box& box) const -> QVector<qsizetype>;
+
+private:
+    // Maximal number of children of every node
+    static constexpr qsizetype nodeCapacity = 16;
+
+    // Generic search method. The predicate decides if the subtree under a
+    // given box needs to be searched.
+    template<typename Predicate>
+    auto searchInternal(Predicate predicate) const -> QVector<qsizetype>;
+
+    // Number of boxes stored in the tree
+    qsizetype m_numItems {0};
+
+    // Boxes of all nodes, level by level. The first m_numItems entries are the
+    // leaves, the last entry is the root.
+    QVector<Box> m_nodes;
+
+    // For each leaf, the index of the box in the list given to the constructor
+    QVector<qsizetype> m_itemIndices;
+
+    // Start offset of each level in m_nodes; the last entry equals
+    // m_nodes.size()
+    QVector<qsizetype> m_levelOffsets;
+};
+
+} // namespace GeoMaps
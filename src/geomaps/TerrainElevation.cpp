@@ -0,0 +1,160 @@
+/***************************************************************************
+ *   Copyright (C) 2023 by Stefan Kebekus                                  *
+ *   stefan.kebekus@gmail.com                                              *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 3 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, write to the                         *
+ *   Free Software Foundation, Inc.,                                       *
+ *   59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.             *
+ ***************************************************************************/
+
+#include <QImage>
+#include <QtMath>
+
+#include "geomaps/TerrainElevation.h"
+
+
+GeoMaps::TerrainElevation::TerrainElevation(qsizetype maxBytes)
+    : m_grids(maxBytes)
+{
+}
+
+
+void GeoMaps::TerrainElevation::setFileNames(const QStringList& fileNames)
+{
+    // MBTILES are QObjects that live in the thread where they were created.
+    // If the last reference is dropped in a worker thread, they must be
+    // deleted in their own thread.
+    QVector<QSharedPointer<MBTILES>> files;
+    foreach(auto fileName, fileNames)
+    {
+        files.append(QSharedPointer<MBTILES>(new MBTILES(fileName), &QObject::deleteLater));
+    }
+
+    QMutexLocker locker(&m_mutex);
+    m_files = files;
+    m_grids.clear();
+}
+
+
+auto GeoMaps::TerrainElevation::elevationAMSL(const QGeoCoordinate& coordinate) -> Units::Distance
+{
+    if (!coordinate.isValid())
+    {
+        return {};
+    }
+
+    auto latitude = qBound(-85.0511287798, coordinate.latitude(), 85.0511287798);
+    auto mercatorX = (coordinate.longitude()+180.0)/360.0;
+    auto mercatorY = (1.0 - asinh(tan(qDegreesToRadians(latitude)))/M_PI)/2.0;
+
+    for(int zoom = zoomMax; zoom >= zoomMin; zoom--)
+    {
+        auto numTiles = 1<<zoom;
+        auto tileX = mercatorX*numTiles;
+        auto tileY = mercatorY*numTiles;
+        auto x = qBound(0, qFloor(tileX), numTiles-1);
+        auto y = qBound(0, qFloor(tileY), numTiles-1);
+
+        auto tileGrid = grid(zoom, x, y);
+        if (tileGrid->elevations.isEmpty())
+        {
+            continue;
+        }
+
+        // Bilinear interpolation between the centers of the pixels. Near the
+        // boundary of the tile, the values at the boundary are used.
+        auto size = tileGrid->size;
+        auto pixelX = qBound(0.0, (tileX-x)*size - 0.5, size-1.0);
+        auto pixelY = qBound(0.0, (tileY-y)*size - 0.5, size-1.0);
+        auto x0 = qMin(qFloor(pixelX), size-1);
+        auto y0 = qMin(qFloor(pixelY), size-1);
+        auto x1 = qMin(x0+1, size-1);
+        auto y1 = qMin(y0+1, size-1);
+        auto tx = pixelX-x0;
+        auto ty = pixelY-y0;
+
+        const auto& elevations = tileGrid->elevations;
+        auto top = (1.0-tx)*elevations[y0*size+x0] + tx*elevations[y0*size+x1];
+        auto bottom = (1.0-tx)*elevations[y1*size+x0] + tx*elevations[y1*size+x1];
+        return Units::Distance::fromM((1.0-ty)*top + ty*bottom);
+    }
+    return {};
+}
+
+
+auto GeoMaps::TerrainElevation::grid(int zoom, int x, int y) -> QSharedPointer<const Grid>
+{
+    QVector<QSharedPointer<MBTILES>> files;
+    {
+        QMutexLocker locker(&m_mutex);
+        auto* cachedGrid = m_grids.object(key(zoom, x, y));
+        if (cachedGrid != nullptr)
+        {
+            return *cachedGrid;
+        }
+        files = m_files;
+    }
+
+    // Decode without holding the lock, so that other threads can sample
+    // cached tiles in the meantime
+    auto result = readGrid(files, zoom, x, y);
+
+    QMutexLocker locker(&m_mutex);
+    if (files == m_files)
+    {
+        auto cost = static_cast<qsizetype>(sizeof(Grid)) + result->elevations.size()*static_cast<qsizetype>(sizeof(qint16));
+        m_grids.insert(key(zoom, x, y), new QSharedPointer<const Grid>(result), cost);
+    }
+    return result;
+}
+
+
+auto GeoMaps::TerrainElevation::readGrid(const QVector<QSharedPointer<MBTILES>>& files, int zoom, int x, int y) -> QSharedPointer<const Grid>
+{
+    auto result = QSharedPointer<Grid>::create();
+    foreach(auto file, files)
+    {
+        if (!file->covers(zoom, x, y))
+        {
+            continue;
+        }
+        auto tileData = file->tile(zoom, x, y);
+        if (tileData.isEmpty())
+        {
+            continue;
+        }
+        QImage image;
+        if (!image.loadFromData(tileData) || (image.width() != image.height()) || (image.width() == 0))
+        {
+            continue;
+        }
+        image.convertTo(QImage::Format_RGB32);
+
+        // Terrarium encoding: elevation = R*256 + G + B/256 - 32768
+        result->size = image.width();
+        result->elevations.resize(static_cast<qsizetype>(result->size)*result->size);
+        for(int row = 0; row < result->size; row++)
+        {
+            const auto* pixels = reinterpret_cast<const QRgb*>(image.constScanLine(row));
+            for(int column = 0; column < result->size; column++)
+            {
+                auto pix = pixels[column];
+                auto elevation = qRound(qRed(pix)*256.0 + qGreen(pix) + qBlue(pix)/256.0 - 32768.0);
+                result->elevations[row*result->size+column] = static_cast<qint16>(qBound(-32768, elevation, 32767));
+            }
+        }
+        break;
+    }
+    return result;
+}
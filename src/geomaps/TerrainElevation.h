@@ -0,0 +1,108 @@
+/***************************************************************************
+ *   Copyright (C) 2023 by Stefan Kebekus                                  *
+ *   stefan.kebekus@gmail.com                                              *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 3 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, write to the                         *
+ *   Free Software Foundation, Inc.,                                       *
+ *   59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.             *
+ ***************************************************************************/
+
+#pragma once
+
+#include <QCache>
+#include <QGeoCoordinate>
+#include <QMutex>
+#include <QSharedPointer>
+#include <QVector>
+
+#include "geomaps/MBTILES.h"
+#include "units/Distance.h"
+
+namespace GeoMaps {
+
+/*! \brief Terrain elevation from terrain maps
+ *
+ *  This class reads terrain elevation from MBTILES files with raster tiles in
+ *  "terrarium" encoding. Tiles are decoded once into compact grids of 16-bit
+ *  integers (elevation in meters), which are kept in a cache with a fixed
+ *  budget in bytes. If the budget is exceeded, the least recently used grids
+ *  are evicted. Elevations between grid points are interpolated bilinearly.
+ *
+ *  The class opens its own instances of the MBTILES files, so that it does
+ *  not depend on the lifetime of other objects. All methods of this class are
+ *  thread-safe. The class can therefore be used from worker threads that
+ *  need to sample many points, for instance to compute terrain profiles.
+ */
+
+class TerrainElevation {
+
+public:
+    /*! \brief Constructs an object without terrain maps
+     *
+     *  @param maxBytes Budget of the grid cache, in bytes
+     */
+    explicit TerrainElevation(qsizetype maxBytes = 16*1024*1024);
+
+    /*! \brief Set terrain maps
+     *
+     *  This method replaces the set of terrain maps and clears the cache.
+     *
+     *  @param fileNames Names of MBTILES files with terrain data
+     */
+    void setFileNames(const QStringList& fileNames);
+
+    /*! \brief Elevation of terrain at a given coordinate, above sea level
+     *
+     *  @param coordinate Coordinate
+     *
+     *  @returns Elevation of the terrain at coordinate, or NaN if the terrain
+     *  elevation is unknown
+     */
+    [[nodiscard]] auto elevationAMSL(const QGeoCoordinate& coordinate) -> Units::Distance;
+
+private:
+    Q_DISABLE_COPY_MOVE(TerrainElevation)
+
+    // Decoded tile: elevation in meters, row by row, starting in the
+    // north-west corner. An empty grid indicates that the tile is not
+    // available in any of the files.
+    struct Grid {
+        int size {0};
+        QVector<qint16> elevations;
+    };
+
+    // Range of zoom levels used for terrain data
+    static constexpr int zoomMin = 6;
+    static constexpr int zoomMax = 10;
+
+    // Returns the grid for a tile, reading and decoding it if necessary
+    auto grid(int zoom, int x, int y) -> QSharedPointer<const Grid>;
+
+    // Reads and decodes a tile from the files
+    static auto readGrid(const QVector<QSharedPointer<MBTILES>>& files, int zoom, int x, int y) -> QSharedPointer<const Grid>;
+
+    // Cache key for a tile
+    static auto key(int zoom, int x, int y) -> quint64
+    {
+        return (static_cast<quint64>(zoom) << 48) | (static_cast<quint64>(x) << 24) | static_cast<quint64>(y);
+    }
+
+    // Terrain maps and grid cache. The cost of a grid is its size in bytes.
+    // Access is protected by the mutex.
+    QMutex m_mutex;
+    QVector<QSharedPointer<MBTILES>> m_files;
+    QCache<quint64, QSharedPointer<const Grid>> m_grids;
+};
+
+} // namespace GeoMaps
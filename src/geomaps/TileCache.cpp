@@ -0,0 +1,108 @@
+/***************************************************************************
+ *   Copyright (C) 2023 by Stefan Kebekus                                  *
+ *   stefan.kebekus@gmail.com                                              *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 3 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, write to the                         *
+ *   Free Software Foundation, Inc.,                                       *
+ *   59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.             *
+ ***************************************************************************/
+
+#include "geomaps/TileCache.h"
+
+
+GeoMaps::TileCache::TileCache(qsizetype maxBytes)
+    : m_cache(maxBytes)
+{
+}
+
+
+auto GeoMaps::TileCache::find(const QString& tileSet, int zoom, int x, int y, QByteArray& data) -> bool
+{
+    QMutexLocker locker(&m_mutex);
+    auto* cachedData = m_cache.object(key(tileSet, zoom, x, y));
+    if (cachedData == nullptr)
+    {
+        m_misses++;
+        return false;
+    }
+    m_hits++;
+    data = *cachedData;
+    return true;
+}
+
+
+auto GeoMaps::TileCache::contains(const QString& tileSet, int zoom, int x, int y) const -> bool
+{
+    QMutexLocker locker(&m_mutex);
+    return m_cache.contains(key(tileSet, zoom, x, y));
+}
+
+
+void GeoMaps::TileCache::insert(const QString& tileSet, int zoom, int x, int y, const QByteArray& data)
+{
+    QMutexLocker locker(&m_mutex);
+    m_cache.insert(key(tileSet, zoom, x, y), new QByteArray(data), data.size()+entryOverhead);
+}
+
+
+void GeoMaps::TileCache::remove(const QString& tileSet)
+{
+    QMutexLocker locker(&m_mutex);
+    foreach(auto cacheKey, m_cache.keys())
+    {
+        if (cacheKey.first == tileSet)
+        {
+            m_cache.remove(cacheKey);
+        }
+    }
+}
+
+
+void GeoMaps::TileCache::setMaxBytes(qsizetype maxBytes)
+{
+    QMutexLocker locker(&m_mutex);
+    m_cache.setMaxCost(maxBytes);
+}
+
+
+auto GeoMaps::TileCache::maxBytes() const -> qsizetype
+{
+    QMutexLocker locker(&m_mutex);
+    return m_cache.maxCost();
+}
+
+
+auto GeoMaps::TileCache::hits() const -> qint64
+{
+    QMutexLocker locker(&m_mutex);
+    return m_hits;
+}
+
+
+auto GeoMaps::TileCache::misses() const -> qint64
+{
+    QMutexLocker locker(&m_mutex);
+    return m_misses;
+}
+
+
+auto GeoMaps::TileCache::hitRate() const -> double
+{
+    QMutexLocker locker(&m_mutex);
+    if (m_hits+m_misses == 0)
+    {
+        return 0.0;
+    }
+    return static_cast<double>(m_hits)/static_cast<double>(m_hits+m_misses);
+}
@@ -0,0 +1,162 @@
+/***************************************************************************
+ *   Copyright (C) 2023 by Stefan Kebekus                                  *
+ *   stefan.kebekus@gmail.com                                              *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 3 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, write to the                         *
+ *   Free Software Foundation, Inc.,                                       *
+ *   59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.             *
+ ***************************************************************************/
+
+#pragma once
+
+#include <QCache>
+#include <QMutex>
+
+namespace GeoMaps {
+
+/*! \brief In-memory cache for tile data
+ *
+ *  This class caches raw tile data, as read from MBTILES files, in order to
+ *  avoid repeated database queries for tiles that the map has requested
+ *  shortly before. Tiles are identified by the name of the tile set and by
+ *  their zoom level and coordinates. The cache also remembers tiles that do
+ *  not exist in any file of the tile set.
+ *
+ *  The cache has a budget in bytes. If the budget is exceeded, the least
+ *  recently used tiles are evicted.
+ *
+ *  All methods of this class are thread-safe.
+ */
+
+class TileCache {
+
+public:
+    /*! \brief Constructs an empty cache
+     *
+     *  @param maxBytes Budget of the cache, in bytes
+     */
+    explicit TileCache(qsizetype maxBytes);
+
+    /*! \brief Look up a tile
+     *
+     *  @param tileSet Name of the tile set
+     *
+     *  @param zoom Zoom level of the tile
+     *
+     *  @param x x-Coordinate of the tile
+     *
+     *  @param y y-Coordinate of the tile
+     *
+     *  @param data If the tile is found in the cache, its data is written
+     *  here. An empty array indicates that the tile set does not contain the
+     *  tile.
+     *
+     *  @returns True if the tile was found in the cache
+     */
+    auto find(const QString& tileSet, int zoom, int x, int y, QByteArray& data) -> bool;
+
+    /*! \brief Check if a tile is in the cache
+     *
+     *  Unlike find(), this method does not count as a lookup and does not
+     *  mark the tile as recently used.
+     *
+     *  @param tileSet Name of the tile set
+     *
+     *  @param zoom Zoom level of the tile
+     *
+     *  @param x x-Coordinate of the tile
+     *
+     *  @param y y-Coordinate of the tile
+     *
+     *  @returns True if the tile is in the cache
+     */
+    [[nodiscard]] auto contains(const QString& tileSet, int zoom, int x, int y) const -> bool;
+
+    /*! \brief Add a tile to the cache
+     *
+     *  @param tileSet Name of the tile set
+     *
+     *  @param zoom Zoom level of the tile
+     *
+     *  @param x x-Coordinate of the tile
+     *
+     *  @param y y-Coordinate of the tile
+     *
+     *  @param data Tile data. An empty array indicates that the tile set does
+     *  not contain the tile.
+     */
+    void insert(const QString& tileSet, int zoom, int x, int y, const QByteArray& data);
+
+    /*! \brief Remove all tiles of a tile set
+     *
+     *  @param tileSet Name of the tile set
+     */
+    void remove(const QString& tileSet);
+
+    /*! \brief Change the budget of the cache
+     *
+     *  If the new budget is smaller than the current one, the least recently
+     *  used tiles are evicted.
+     *
+     *  @param maxBytes Budget of the cache, in bytes
+     */
+    void setMaxBytes(qsizetype maxBytes);
+
+    /*! \brief Budget of the cache
+     *
+     *  @returns Budget of the cache, in bytes
+     */
+    [[nodiscard]] auto maxBytes() const -> qsizetype;
+
+    /*! \brief Number of successful lookups since construction
+     *
+     *  @returns Number of calls to find() that returned true
+     */
+    [[nodiscard]] auto hits() const -> qint64;
+
+    /*! \brief Number of failed lookups since construction
+     *
+     *  @returns Number of calls to find() that returned false
+     */
+    [[nodiscard]] auto misses() const -> qint64;
+
+    /*! \brief Ratio of successful lookups
+     *
+     *  @returns Number between 0 and 1, or 0 if find() has never been called
+     */
+    [[nodiscard]] auto hitRate() const -> double;
+
+private:
+    Q_DISABLE_COPY_MOVE(TileCache)
+
+    // Approximate memory overhead of a cache entry, in bytes. This is used as
+    // the cost of entries for tiles that do not exist.
+    static constexpr qsizetype entryOverhead = 64;
+
+    // Key identifying a tile
+    using Key = QPair<QString, quint64>;
+    static auto key(const QString& tileSet, int zoom, int x, int y) -> Key
+    {
+        return {tileSet, (static_cast<quint64>(zoom) << 48) | (static_cast<quint64>(x) << 24) | static_cast<quint64>(y)};
+    }
+
+    // Cache, with cost equal to the size in bytes. Access is protected by the
+    // mutex.
+    mutable QMutex m_mutex;
+    QCache<Key, QByteArray> m_cache;
+    qint64 m_hits {0};
+    qint64 m_misses {0};
+};
+
+} // namespace GeoMaps
@@ -18,15 +18,18 @@
  *   59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.             *
  ***************************************************************************/
 
-#include <QHttpServerResponder>
+#include <QCryptographicHash>
+#include <QFileInfo>
 #include <QJsonArray>
+#include <QJsonDocument>
 #include <QJsonObject>
 #include <QPointer>
 
 #include "TileHandler.h"
 
 
-GeoMaps::TileHandler::TileHandler(const QVector<QPointer<GeoMaps::MBTILES>>& mbtileFiles, const QString& baseURL)
+GeoMaps::TileHandler::TileHandler(const QVector<QPointer<GeoMaps::MBTILES>>& mbtileFiles, const QString& baseURL, const QSharedPointer<GeoMaps::TileCache>& tileCache)
+    : m_tileCache(tileCache), m_tileSetName(baseURL)
 {
     m_mbtiles = mbtileFiles;
 
@@ -52,6 +55,12 @@ GeoMaps::TileHandler::TileHandler(const QVector<QPointer<GeoMaps::MBTILES>>& mbt
             continue;
         }
 
+        auto lastModified = QFileInfo(mbtPtr->fileName()).lastModified();
+        if (!m_lastModified.isValid() || (lastModified > m_lastModified))
+        {
+            m_lastModified = lastModified;
+        }
+
         _name = mbtPtr->metaData().value(QStringLiteral("name"));
         _encoding = mbtPtr->metaData().value(QStringLiteral("encoding"));
         m_format = mbtPtr->metaData().value(QStringLiteral("format"));
@@ -73,6 +82,13 @@ GeoMaps::TileHandler::TileHandler(const QVector<QPointer<GeoMaps::MBTILES>>& mbt
 
     _tiles = baseURL+"/{z}/{x}/{y}."+m_format;
 
+    // Tiles are never revalidated, so their entity tags need not depend on
+    // the content, and are computed without hashing the tile data
+    QCryptographicHash eTagHash(QCryptographicHash::Md5);
+    eTagHash.addData(baseURL.toUtf8());
+    eTagHash.addData(QByteArray::number(m_lastModified.toMSecsSinceEpoch()));
+    m_eTagPrefix = eTagHash.result().toHex().left(16);
+
     QJsonObject result;
     result.insert(QStringLiteral("tilejson"), "2.2.0");
 
@@ -114,54 +130,96 @@ GeoMaps::TileHandler::TileHandler(const QVector<QPointer<GeoMaps::MBTILES>>& mbt
         result.insert(QStringLiteral("minzoom"), _minzoom);
     }
 
-    m_tileJSON.setObject(result);
+    m_tileJSON = QJsonDocument(result).toJson(QJsonDocument::Compact);
+    m_minZoom = _minzoom;
+    m_maxZoom = _maxzoom;
+}
+
+
+auto GeoMaps::TileHandler::processTileJSON() const -> Reply
+{
+    Reply reply;
+    reply.status = QHttpServerResponder::StatusCode::Ok;
+    reply.headers = {{"Content-Type", "application/json"}, {"Cache-Control", "no-cache"}};
+    reply.body = m_tileJSON;
+    reply.lastModified = m_lastModified;
+    return reply;
 }
 
 
-bool GeoMaps::TileHandler::process(QHttpServerResponder* responder, const QStringList &pathElements)
+auto GeoMaps::TileHandler::processTile(int z, int x, int y) -> Reply
 {
-    // Serve tileJSON file, if requested
-    if (pathElements.isEmpty() || pathElements[0].endsWith(u"json"_qs, Qt::CaseInsensitive))
+    Reply reply;
+    auto tileData = this->tileData(z, x, y);
+    if (tileData.isEmpty())
     {
-        responder->write(m_tileJSON);
-        return true;
+        return reply;
     }
 
-    if (pathElements.size() != 3)
+    // The base URL changes whenever the set of MBTiles files changes, so tiles
+    // never change for the client
+    reply.status = QHttpServerResponder::StatusCode::Ok;
+    if (m_format == u"pbf"_qs)
     {
-        return false;
+        reply.headers = {{"Content-Type", "application/octet-stream"}, {"Content-Encoding", "gzip"}};
     }
+    else
+    {
+        reply.headers = {{"Content-Type", "application/octet-stream"}};
+    }
+    reply.headers.append({"Cache-Control", "max-age=31536000, immutable"});
+    reply.body = tileData;
+    reply.lastModified = m_lastModified;
+    reply.eTag = '"' + m_eTagPrefix + '-' + QByteArray::number(z) + '-' + QByteArray::number(x) + '-' + QByteArray::number(y) + '"';
+    return reply;
+}
 
-    // Serve tile, if requested
-    auto z = pathElements[0].toInt();
-    auto x = pathElements[1].toInt();
-    auto y = pathElements[2].section('.', 0, 0).toInt();
 
-    // Retrieve tile data from the database
-    foreach(auto mbtilesPtr, m_mbtiles)
+auto GeoMaps::TileHandler::prefetch(int z, int x, int y) -> qsizetype
+{
+    // Prefetching does not count as a lookup in the tile cache
+    if (m_tileCache.isNull() || m_tileCache->contains(m_tileSetName, z, x, y))
     {
-        if (mbtilesPtr.isNull())
-        {
-            continue;
-        }
+        return 0;
+    }
+    auto data = readTile(z, x, y);
+    m_tileCache->insert(m_tileSetName, z, x, y, data);
+    return data.size();
+}
 
-        // Get data
-        QByteArray tileData = mbtilesPtr->tile(z,x,y);
-        if (tileData.isEmpty())
-        {
-            continue;
-        }
 
-        if (m_format == u"pbf"_qs)
+auto GeoMaps::TileHandler::readTile(int z, int x, int y) -> QByteArray
+{
+    foreach(auto mbtilesPtr, m_mbtiles)
+    {
+        if (mbtilesPtr.isNull() || !mbtilesPtr->covers(z,x,y))
         {
-            responder->write(tileData, {{"Content-Type", "application/octet-stream"}, {"Content-Encoding", "gzip"}});
+            continue;
         }
-        else
+        auto result = mbtilesPtr->tile(z,x,y);
+        if (!result.isEmpty())
         {
-            responder->write(tileData, "application/octet-stream");
+            return result;
         }
-        return true;
     }
+    return {};
+}
 
-    return false;
+
+auto GeoMaps::TileHandler::tileData(int z, int x, int y) -> QByteArray
+{
+    // Retrieve tile data from the cache or, failing that, from the database.
+    // Tiles that are not contained in any of the files are cached as empty
+    // arrays.
+    QByteArray result;
+    if (m_tileCache.isNull())
+    {
+        return readTile(z, x, y);
+    }
+    if (!m_tileCache->find(m_tileSetName, z, x, y, result))
+    {
+        result = readTile(z, x, y);
+        m_tileCache->insert(m_tileSetName, z, x, y, result);
+    }
+    return result;
 }
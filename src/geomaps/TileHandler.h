@@ -20,11 +20,11 @@
 
 #pragma once
 
-#include <QJsonDocument>
+#include <QDateTime>
+#include <QHttpServerResponder>
 
 #include <geomaps/MBTILES.h>
-
-class QHttpServerResponder;
+#include <geomaps/TileCache.h>
 
 namespace GeoMaps {
 
@@ -32,16 +32,44 @@ namespace GeoMaps {
 /*! \brief Implementation of QHttpEngine::Handler that serves mbtile files
  *
  *  This is a helper clas for TileServer. It gathers a set of MBTiles files.
- *  The method process() takes the path of an incoming HTTP request and uses a
- *  QHttpServerResponder to reply with appropriate tile data, and with TileJSON
+ *  The methods processTile() and processTileJSON() compute replies to
+ *  incoming HTTP requests, with appropriate tile data, or with TileJSON
  *  (following the TileJSON Specification 2.2.0 found in
- *  https://github.com/mapbox/tilejson-spec/tree/master/2.2.0).
+ *  https://github.com/mapbox/tilejson-spec/tree/master/2.2.0). Parsing the
+ *  request path is left to TileServer.
+ *
+ *  These methods are thread-safe, so that TileServer can run them in a
+ *  worker thread.
  */
 
 class TileHandler
 {
 
 public:
+    /*! \brief Reply to an HTTP request
+     *
+     *  This is a self-contained description of an HTTP reply. It can be
+     *  computed in any thread and sent later by TileServer.
+     */
+    struct Reply {
+        /*! \brief HTTP status code */
+        QHttpServerResponder::StatusCode status {QHttpServerResponder::StatusCode::NotFound};
+
+        /*! \brief HTTP headers, except for Content-Length, ETag and Last-Modified */
+        QList<QPair<QByteArray, QByteArray>> headers;
+
+        /*! \brief Body of the reply */
+        QByteArray body;
+
+        /*! \brief Modification time of the data, or an invalid QDateTime if unknown */
+        QDateTime lastModified;
+
+        /*! \brief Entity tag of the reply, including quotes. If empty, the
+         *  tag is computed from the body.
+         */
+        QByteArray eTag;
+    };
+
     /*! \brief Create a new tile handler
     *
     *  This constructor sets up a new tile handler.
@@ -55,38 +83,105 @@ public:
     *  @param baseURLName The name of the URL under which the tile server allows
     *  access to this tile. Typically, this is a string of the form
     *  "http://localhost:8080/osm"
+    *
+    *  @param tileCache Cache for tile data, possibly shared with other tile
+    *  handlers. Tiles are stored in the cache under the name baseURLName. If
+    *  this is a nullptr, tiles are not cached.
     */
-    explicit TileHandler(const QVector<QPointer<GeoMaps::MBTILES>>& mbtileFiles, const QString& baseURLName);
+    explicit TileHandler(const QVector<QPointer<GeoMaps::MBTILES>>& mbtileFiles, const QString& baseURLName, const QSharedPointer<GeoMaps::TileCache>& tileCache = {});
 
     // Standard descructor
     ~TileHandler() = default;
 
-    /*! \brief Process request
+    /*! \brief Process request for a tile
+    *
+    *  The method computes the reply to a request for a tile. This method is
+    *  thread-safe.
+    *
+    *  @param z Zoom level of the tile
+    *
+    *  @param x x-Coordinate of the tile
+    *
+    *  @param y y-Coordinate of the tile, counted from the north
+    *
+    *  @return Reply. If the tile does not exist, the status of the reply is
+    *  QHttpServerResponder::StatusCode::NotFound.
+    */
+    auto processTile(int z, int x, int y) -> Reply;
+
+    /*! \brief Process request for the TileJSON document
+    *
+    *  This method is thread-safe.
+    *
+    *  @return Reply with the TileJSON document describing the tile set
+    */
+    [[nodiscard]] auto processTileJSON() const -> Reply;
+
+    /*! \brief Load a tile into the tile cache
+    *
+    *  If the tile is not yet in the tile cache, this method reads it from the
+    *  MBTiles files and adds it to the cache, so that later requests for the
+    *  tile can be answered without database access. This method is
+    *  thread-safe.
     *
-    *  The method processes and answers an incomin HTTP request for TileServer.
+    *  @param z Zoom level of the tile
     *
-    *  @param responder QHttpServerResponder that is used to send the reply.
+    *  @param x x-Coordinate of the tile
     *
-    *  @param pathElements URL string of the incoming HTTP request. This is the
-    *  part of the URL following the baseURLName that was given in the
-    *  constructor, split at the '/'.
+    *  @param y y-Coordinate of the tile, counted from the north
+    *
+    *  @returns Number of bytes added to the tile cache, or 0 if the tile was
+    *  already there
+    */
+    auto prefetch(int z, int x, int y) -> qsizetype;
+
+    /*! \brief Minimal zoom level of the tiles
+    *
+    *  @returns Minimal zoom level, as given in the metadata of the files
+    */
+    [[nodiscard]] auto minZoom() const -> int { return m_minZoom; }
+
+    /*! \brief Maximal zoom level of the tiles
     *
-    *  @return True if the request could be answered.
+    *  @returns Maximal zoom level, as given in the metadata of the files
     */
-    bool process(QHttpServerResponder* responder, const QStringList& pathElements);
+    [[nodiscard]] auto maxZoom() const -> int { return m_maxZoom; }
 
 private:
     Q_DISABLE_COPY_MOVE(TileHandler)
 
+    // Reads a tile from the MBTiles files, without looking at the tile cache.
+    // An empty array indicates that the tile does not exist.
+    auto readTile(int z, int x, int y) -> QByteArray;
+
+    // Tile data, from the tile cache or, failing that, from the MBTiles
+    // files. An empty array indicates that the tile does not exist.
+    auto tileData(int z, int x, int y) -> QByteArray;
+
     // List of MBTiles
     QVector<QPointer<GeoMaps::MBTILES>> m_mbtiles;
 
+    // Tile cache, and name of the tile set in the cache
+    QSharedPointer<GeoMaps::TileCache> m_tileCache;
+    QString m_tileSetName;
+
     // Format of tiles. This is a short string such as "jpg", "pbf", "png" or
     // "webp".
     QString m_format;
 
-    // TileJSON that will be served in appropriate requests.
-    QJsonDocument m_tileJSON;
+    // TileJSON that will be served in appropriate requests, in compact form
+    QByteArray m_tileJSON;
+
+    // Latest modification time of the MBTiles files
+    QDateTime m_lastModified;
+
+    // Prefix of the entity tags of tiles, computed from the name of the tile
+    // set and from m_lastModified
+    QByteArray m_eTagPrefix;
+
+    // Range of zoom levels
+    int m_minZoom {-1};
+    int m_maxZoom {-1};
 };
 
 } // namespace GeoMaps
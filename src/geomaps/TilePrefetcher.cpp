@@ -0,0 +1,134 @@
+/***************************************************************************
+ *   Copyright (C) 2023 by Stefan Kebekus                                  *
+ *   stefan.kebekus@gmail.com                                              *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 3 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, write to the                         *
+ *   Free Software Foundation, Inc.,                                       *
+ *   59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.             *
+ ***************************************************************************/
+
+#include <QtConcurrent/QtConcurrentRun>
+
+#include "GlobalObject.h"
+#include "geomaps/TerrainElevation.h"
+#include "geomaps/TilePrefetcher.h"
+#include "geomaps/TileServer.h"
+#include "navigation/FlightRoute.h"
+#include "navigation/Navigator.h"
+#include "positioning/PositionProvider.h"
+
+
+GeoMaps::TilePrefetcher::TilePrefetcher(GeoMaps::TileServer* tileServer, GeoMaps::TerrainElevation* terrainElevation, QObject* parent)
+    : QObject(parent), m_tileServer(tileServer), m_terrainElevation(terrainElevation)
+{
+}
+
+
+GeoMaps::TilePrefetcher::~TilePrefetcher()
+{
+    m_terrainFuture.waitForFinished();
+}
+
+
+void GeoMaps::TilePrefetcher::update()
+{
+    if (GlobalObject::navigator()->flightStatus() != Navigation::Navigator::Flight)
+    {
+        return;
+    }
+    if (m_lastPrefetch.isValid() && (m_lastPrefetch.elapsed() < minimumIntervalMS))
+    {
+        return;
+    }
+
+    auto positions = positionsAhead();
+    if (positions.isEmpty())
+    {
+        return;
+    }
+    m_lastPrefetch.start();
+
+    m_tileServer->prefetch(positions, minZoom, maxZoom);
+
+    // Reading terrain elevation decodes the terrain grids and keeps them in
+    // the cache of TerrainElevation
+    if (m_terrainFuture.isRunning())
+    {
+        return;
+    }
+    auto* terrainElevation = m_terrainElevation;
+    m_terrainFuture = QtConcurrent::run([terrainElevation, positions]() {
+        foreach(auto position, positions)
+        {
+            (void)terrainElevation->elevationAMSL(position);
+        }
+    });
+}
+
+
+void GeoMaps::TilePrefetcher::reset()
+{
+    m_lastPrefetch.invalidate();
+}
+
+
+auto GeoMaps::TilePrefetcher::positionsAhead() -> QVector<QGeoCoordinate>
+{
+    QVector<QGeoCoordinate> result;
+
+    auto positionInfo = GlobalObject::positionProvider()->positionInfo();
+    if (!positionInfo.isValid())
+    {
+        return result;
+    }
+    auto position = positionInfo.coordinate();
+    result.append(position);
+
+    auto groundSpeed = positionInfo.groundSpeed();
+    auto trueTrack = positionInfo.trueTrack();
+    if (!groundSpeed.isFinite() || !trueTrack.isFinite())
+    {
+        return result;
+    }
+    auto lookAheadDistance = qMin(groundSpeed.toMPS()*lookAheadTimeS, maxLookAheadDistanceM);
+
+    // Positions along the present track
+    for(auto distance = spacingM; distance <= lookAheadDistance; distance += spacingM)
+    {
+        result.append(position.atDistanceAndAzimuth(distance, trueTrack.toDEG()));
+    }
+
+    // Positions along the flight route that are within reach
+    foreach(auto leg, GlobalObject::navigator()->flightRoute()->legs())
+    {
+        if (!leg.isValid())
+        {
+            continue;
+        }
+        auto start = leg.startPoint().coordinate();
+        auto end = leg.endPoint().coordinate();
+        auto length = start.distanceTo(end);
+        auto azimuth = start.azimuthTo(end);
+        for(auto distance = 0.0; distance <= length; distance += spacingM)
+        {
+            auto routePosition = start.atDistanceAndAzimuth(distance, azimuth);
+            if (position.distanceTo(routePosition) <= lookAheadDistance)
+            {
+                result.append(routePosition);
+            }
+        }
+    }
+
+    return result;
+}
@@ -0,0 +1,118 @@
+/***************************************************************************
+ *   Copyright (C) 2023 by Stefan Kebekus                                  *
+ *   stefan.kebekus@gmail.com                                              *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 3 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, write to the                         *
+ *   Free Software Foundation, Inc.,                                       *
+ *   59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.             *
+ ***************************************************************************/
+
+#pragma once
+
+#include <QElapsedTimer>
+#include <QFuture>
+#include <QGeoCoordinate>
+#include <QObject>
+
+namespace GeoMaps {
+
+class TerrainElevation;
+class TileServer;
+
+/*! \brief Loads map tiles and terrain data for the area ahead of the aircraft
+ *
+ *  While flying, the map requests tiles only once they scroll into view. This
+ *  class makes sure that these tiles are already in memory by then. It
+ *  estimates the area that the aircraft will reach within the next minutes,
+ *  from position, track and ground speed reported by the PositionProvider,
+ *  and from the legs of the current flight route. It then asks the
+ *  TileServer to load the tiles for that area into its tile cache, and
+ *  decodes the terrain elevation data for that area.
+ *
+ *  All work is done in worker threads. To keep the load low, prefetching is
+ *  done at most once every few seconds, and only if the aircraft is flying.
+ */
+
+class TilePrefetcher : public QObject
+{
+    Q_OBJECT
+
+public:
+    /*! \brief Standard constructor
+     *
+     *  @param tileServer Tile server whose cache is filled. The tile server
+     *  must outlive this object.
+     *
+     *  @param terrainElevation Terrain elevation whose cache is filled. This
+     *  object must outlive the prefetcher.
+     *
+     *  @param parent The standard QObject parent pointer
+     */
+    TilePrefetcher(GeoMaps::TileServer* tileServer, GeoMaps::TerrainElevation* terrainElevation, QObject* parent = nullptr);
+
+    /*! \brief Destructor
+     *
+     *  The destructor waits until the terrain data is no longer accessed.
+     */
+    ~TilePrefetcher() override;
+
+public slots:
+    /*! \brief Prefetch tiles for the current position
+     *
+     *  This slot is meant to be called whenever the position changes. It
+     *  returns immediately if the aircraft is not flying, or if the last
+     *  prefetch was done very recently.
+     */
+    void update();
+
+    /*! \brief Forget about the last prefetch
+     *
+     *  This slot is meant to be called when the flight route changes. The
+     *  next call to update() will then prefetch tiles immediately.
+     */
+    void reset();
+
+private:
+    Q_DISABLE_COPY_MOVE(TilePrefetcher)
+
+    // Positions that the aircraft will probably reach within lookAheadTime:
+    // the present position, points along the present track, and points along
+    // the flight route.
+    [[nodiscard]] static auto positionsAhead() -> QVector<QGeoCoordinate>;
+
+    // Time and distance that the prefetcher looks ahead. The distance is
+    // capped, so that the amount of data stays reasonable for fast aircraft.
+    static constexpr double lookAheadTimeS = 5*60.0;
+    static constexpr double maxLookAheadDistanceM = 100000.0;
+
+    // Distance between two positions along track and route
+    static constexpr double spacingM = 2000.0;
+
+    // Minimal time between two prefetches
+    static constexpr qint64 minimumIntervalMS = 30*1000;
+
+    // Range of zoom levels that are prefetched. Higher zoom levels are rarely
+    // used in flight.
+    static constexpr int minZoom = 6;
+    static constexpr int maxZoom = 12;
+
+    GeoMaps::TileServer* m_tileServer;
+    GeoMaps::TerrainElevation* m_terrainElevation;
+
+    // Time of the last prefetch, and computation that reads terrain data
+    QElapsedTimer m_lastPrefetch;
+    QFuture<void> m_terrainFuture;
+};
+
+} // namespace GeoMaps
@@ -18,16 +18,193 @@
  *   59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.             *
  ***************************************************************************/
 
+#include <QCryptographicHash>
+#include <QDirIterator>
+#include <QFile>
 #include <QHttpServerRequest>
 #include <QHttpServerResponder>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QLocale>
+#include <QPointer>
+#include <QSet>
+#include <QTcpSocket>
+#include <QThread>
+#include <QtMath>
+#include <memory>
 
 #include "TileServer.h"
-#include "geomaps/GeoMapProvider.h"
 
 
-GeoMaps::TileServer::TileServer(QObject* parent)
-    : QAbstractHttpServer(parent)
+namespace {
+
+// Format of dates in HTTP headers, see RFC 9110, Section 5.6.7
+const QString httpDateFormat = QStringLiteral("ddd, dd MMM yyyy hh:mm:ss 'GMT'");
+
+auto httpDate(const QDateTime& dateTime) -> QByteArray
+{
+    return QLocale::c().toString(dateTime.toUTC(), httpDateFormat).toLatin1();
+}
+
+auto parseHttpDate(const QByteArray& string) -> QDateTime
+{
+    auto result = QLocale::c().toDateTime(QString::fromLatin1(string.trimmed()), httpDateFormat);
+    result.setTimeSpec(Qt::UTC);
+    return result;
+}
+
+// Adds the validators ETag and Last-Modified to a successful reply. Unless the
+// reply brings its own entity tag, the tag is a hash of the body. If the
+// request headers If-None-Match or If-Modified-Since show that the client
+// already has the data, the reply is turned into "304 Not Modified".
+void applyValidators(GeoMaps::TileHandler::Reply& reply, const QByteArray& ifNoneMatch, const QByteArray& ifModifiedSince)
+{
+    if (reply.status != QHttpServerResponder::StatusCode::Ok)
+    {
+        return;
+    }
+
+    auto eTag = reply.eTag;
+    if (eTag.isEmpty())
+    {
+        eTag = '"' + QCryptographicHash::hash(reply.body, QCryptographicHash::Md5).toHex() + '"';
+    }
+    reply.headers.append({"ETag", eTag});
+    if (reply.lastModified.isValid())
+    {
+        reply.headers.append({"Last-Modified", httpDate(reply.lastModified)});
+    }
+
+    // If-None-Match takes precedence over If-Modified-Since
+    bool notModified = false;
+    if (!ifNoneMatch.isEmpty())
+    {
+        foreach(auto candidate, ifNoneMatch.split(','))
+        {
+            candidate = candidate.trimmed();
+            if (candidate.startsWith("W/"))
+            {
+                candidate = candidate.mid(2);
+            }
+            if ((candidate == "*") || (candidate == eTag))
+            {
+                notModified = true;
+            }
+        }
+    }
+    else if (!ifModifiedSince.isEmpty() && reply.lastModified.isValid())
+    {
+        // HTTP dates have a resolution of one second
+        auto since = parseHttpDate(ifModifiedSince);
+        notModified = since.isValid() && (reply.lastModified.toSecsSinceEpoch() <= since.toSecsSinceEpoch());
+    }
+
+    if (notModified)
+    {
+        reply.status = QHttpServerResponder::StatusCode::NotModified;
+        reply.body.clear();
+    }
+}
+
+// Tiles at a given zoom level that contain one of the positions, together
+// with their eight neighbours, in the XYZ scheme. Every tile is listed once.
+auto tilesAround(const QVector<QGeoCoordinate>& positions, int zoom) -> QVector<QPoint>
+{
+    QVector<QPoint> result;
+    QSet<quint64> found;
+    auto numTiles = 1 << zoom;
+    foreach(auto position, positions)
+    {
+        if (!position.isValid())
+        {
+            continue;
+        }
+
+        // Web Mercator projection, restricted to the latitudes that it covers
+        auto latitude = qDegreesToRadians(qBound(-85.0511, position.latitude(), 85.0511));
+        auto x = qFloor((position.longitude()+180.0)/360.0*numTiles);
+        auto y = qFloor((1.0-qLn(qTan(latitude)+1.0/qCos(latitude))/M_PI)/2.0*numTiles);
+        for(int dx=-1; dx<=1; dx++)
+        {
+            for(int dy=-1; dy<=1; dy++)
+            {
+                auto tileX = (x+dx+numTiles) % numTiles;
+                auto tileY = y+dy;
+                if ((tileY < 0) || (tileY >= numTiles))
+                {
+                    continue;
+                }
+                auto key = (static_cast<quint64>(tileX) << 32) | static_cast<quint64>(tileY);
+                if (found.contains(key))
+                {
+                    continue;
+                }
+                found.insert(key);
+                result.append(QPoint(tileX, tileY));
+            }
+        }
+    }
+    return result;
+}
+
+// Parses a path of the form "z/x/y.ext", where the extension is optional.
+// Returns false if the path is not of this form, or if the numbers are out of
+// range.
+auto parseTilePath(QStringView path, int& z, int& x, int& y) -> bool
+{
+    auto next = [&path](QChar separator, int& value) {
+        auto index = path.indexOf(separator);
+        auto element = (index < 0) ? path : path.first(index);
+        path = (index < 0) ? QStringView() : path.sliced(index+1);
+        bool ok = false;
+        value = element.toInt(&ok);
+        return ok;
+    };
+    if (!next(u'/', z) || !next(u'/', x) || !next(u'.', y) || path.contains(u'/'))
+    {
+        return false;
+    }
+    if ((z < 0) || (z > 30))
+    {
+        return false;
+    }
+    return (x >= 0) && (x < (1<<z)) && (y >= 0) && (y < (1<<z));
+}
+
+// Sends a reply that was computed by TileHandler
+void writeReply(QHttpServerResponder& responder, const GeoMaps::TileHandler::Reply& reply)
 {
+    responder.writeStatusLine(reply.status);
+    for(const auto& header : reply.headers)
+    {
+        responder.writeHeader(header.first, header.second);
+    }
+    if (reply.status != QHttpServerResponder::StatusCode::NotModified)
+    {
+        responder.writeHeader("Content-Length", QByteArray::number(reply.body.size()));
+    }
+    responder.writeBody(reply.body);
+}
+
+} // namespace
+
+
+GeoMaps::TileServer::TileServer(Units::ByteSize tileCacheSize, QObject* parent)
+    : QAbstractHttpServer(parent),
+      m_tileCache(new GeoMaps::TileCache(static_cast<qsizetype>(tileCacheSize)))
+{
+    // SQLite queries and tile encoding are fast, so few threads suffice
+    m_threadPool.setMaxThreadCount(qBound(2, QThread::idealThreadCount(), 4));
+
+    // The content of the resource system never changes, so the list of files
+    // is set up once
+    QDirIterator iterator(QStringLiteral(":/"), QDir::Files, QDirIterator::Subdirectories);
+    while (iterator.hasNext())
+    {
+        m_resourceFiles.insert(iterator.next().mid(1));
+    }
+
     listen(QHostAddress(QStringLiteral("127.0.0.1")));
 }
 
@@ -35,14 +212,78 @@ GeoMaps::TileServer::TileServer(QObject* parent)
 void GeoMaps::TileServer::addMbtilesFileSet(const QString& baseName, const QVector<QPointer<GeoMaps::MBTILES>>& MBTilesFiles)
 {
     QString URL = serverUrl()+"/"+baseName;
-    auto* handler = new TileHandler(MBTilesFiles, URL);
+    auto* handler = new TileHandler(MBTilesFiles, URL, m_tileCache);
     m_tileHandlers[baseName] = QSharedPointer<GeoMaps::TileHandler>(handler);
 }
 
 
+void GeoMaps::TileServer::setAviationData(const std::function<QByteArray()>& geoJSON, const std::function<QSharedPointer<GeoMaps::AviationTiles>()>& aviationTiles)
+{
+    m_geoJSON = geoJSON;
+    m_aviationTiles = aviationTiles;
+}
+
+
 void GeoMaps::TileServer::removeMbtilesFileSet(const QString& baseName)
 {
     m_tileHandlers.take(baseName);
+    m_prefetchGeneration++;
+    m_threadPool.waitForDone();
+    m_tileCache->remove(serverUrl()+"/"+baseName);
+}
+
+
+void GeoMaps::TileServer::setTileCacheSize(Units::ByteSize size)
+{
+    m_tileCache->setMaxBytes(static_cast<qsizetype>(size));
+}
+
+
+void GeoMaps::TileServer::prefetch(const QVector<QGeoCoordinate>& positions, int minZoom, int maxZoom)
+{
+    auto generation = ++m_prefetchGeneration;
+    auto budgetPerTileSet = m_tileCache->maxBytes()/prefetchBudgetDivisor/qMax(qsizetype(1), m_tileHandlers.size());
+
+    foreach(auto tileHandler, m_tileHandlers)
+    {
+        if (tileHandler.isNull())
+        {
+            continue;
+        }
+
+        // Coarse zoom levels first, because they are needed first when the
+        // map is zoomed out, and because they are cheap
+        QVector<QPair<int, QPoint>> tiles;
+        for(auto zoom = qMax(minZoom, tileHandler->minZoom()); zoom <= qMin(maxZoom, tileHandler->maxZoom()); zoom++)
+        {
+            foreach(auto tile, tilesAround(positions, zoom))
+            {
+                tiles.append({zoom, tile});
+            }
+        }
+        if (tiles.size() > maxPrefetchTiles)
+        {
+            tiles.resize(maxPrefetchTiles);
+        }
+
+        // Small batches, so that HTTP requests never wait long for a thread.
+        // The batches share the byte budget of the tile set.
+        QSharedPointer<QAtomicInteger<qsizetype>> budget(new QAtomicInteger<qsizetype>(budgetPerTileSet));
+        for(qsizetype start=0; start<tiles.size(); start += prefetchBatchSize)
+        {
+            auto batch = tiles.mid(start, prefetchBatchSize);
+            m_threadPool.start([this, tileHandler, batch, generation, budget]() {
+                foreach(auto tile, batch)
+                {
+                    if ((m_prefetchGeneration.loadRelaxed() != generation) || (budget->loadRelaxed() <= 0))
+                    {
+                        return;
+                    }
+                    budget->fetchAndAddRelaxed(-tileHandler->prefetch(tile.first, tile.second.x(), tile.second.y()));
+                }
+            }, -1);
+        }
+    }
 }
 
 
@@ -61,49 +302,138 @@ auto GeoMaps::TileServer::serverUrl() -> QString
 
 bool GeoMaps::TileServer::handleRequest(const QHttpServerRequest& request, QTcpSocket* socket)
 {
+    // The path is examined through string views, without copying
     auto path = request.url().path();
-    auto pathElements = path.split('/', Qt::SkipEmptyParts);
-    auto responder = makeResponder(request, socket);
+    QStringView pathView(path);
+    while (pathView.startsWith(u'/'))
+    {
+        pathView = pathView.sliced(1);
+    }
+    auto slash = pathView.indexOf(u'/');
+    auto firstElement = (slash < 0) ? pathView : pathView.first(slash);
+    auto remainder = (slash < 0) ? QStringView() : pathView.sliced(slash+1);
 
     //
     // Paranoid safety check
     //
-    if (pathElements.isEmpty())
+    if (firstElement.isEmpty())
     {
         return false;
     }
 
+    //
+    // Tile data. This is by far the most frequent request, so it is checked
+    // first. There are only a few tile handlers, and a linear search is
+    // fastest.
+    //
+    for(auto iterator = m_tileHandlers.cbegin(); iterator != m_tileHandlers.cend(); iterator++)
+    {
+        if (iterator.key() != firstElement)
+        {
+            continue;
+        }
+        auto tileHandler = iterator.value();
+        if (tileHandler.isNull())
+        {
+            return false;
+        }
+        if (remainder.isEmpty() || remainder.endsWith(u"json", Qt::CaseInsensitive))
+        {
+            replyInWorkerThread(request, socket, [tileHandler]() {
+                return tileHandler->processTileJSON();
+            });
+            return true;
+        }
+        int z = 0;
+        int x = 0;
+        int y = 0;
+        if (!parseTilePath(remainder, z, x, y))
+        {
+            return false;
+        }
+        replyInWorkerThread(request, socket, [tileHandler, z, x, y]() {
+            return tileHandler->processTile(z, x, y);
+        });
+        return true;
+    }
+
     //
     // GeoJSON with aviation data
     //
-    if (path.endsWith(u"aviationData.geojson"_qs))
+    if (pathView.endsWith(u"aviationData.geojson") && m_geoJSON)
     {
-        responder.write(GlobalObject::geoMapProvider()->geoJSON(), "application/json");
+        auto geoJSON = m_geoJSON();
+        replyInWorkerThread(request, socket, [geoJSON]() {
+            GeoMaps::TileHandler::Reply reply;
+            reply.status = QHttpServerResponder::StatusCode::Ok;
+            reply.headers = {{"Content-Type", "application/json"}, {"Cache-Control", "no-cache"}};
+            reply.body = geoJSON;
+            return reply;
+        });
         return true;
     }
 
     //
-    // File from resource system
+    // Aviation data as vector tiles
     //
-    if (QFile::exists(":"+path))
+    if ((firstElement == u"aviationData.json") && m_aviationTiles)
     {
-        auto* file = new QFile(":"+path);
-        responder.write(file, "application/octet-stream");
+        QJsonObject layer;
+        layer.insert(QStringLiteral("id"), AviationTiles::layerName());
+        layer.insert(QStringLiteral("fields"), QJsonObject());
+
+        QJsonObject tileJSON;
+        tileJSON.insert(QStringLiteral("tilejson"), "2.2.0");
+        tileJSON.insert(QStringLiteral("tiles"), QJsonArray({serverUrl()+"/aviationData/{z}/{x}/{y}.pbf"}));
+        tileJSON.insert(QStringLiteral("format"), "pbf");
+        tileJSON.insert(QStringLiteral("minzoom"), AviationTiles::minZoom);
+        tileJSON.insert(QStringLiteral("maxzoom"), AviationTiles::maxZoom);
+        tileJSON.insert(QStringLiteral("vector_layers"), QJsonArray({layer}));
+        auto tileJSONData = QJsonDocument(tileJSON).toJson(QJsonDocument::Compact);
+        replyInWorkerThread(request, socket, [tileJSONData]() {
+            GeoMaps::TileHandler::Reply reply;
+            reply.status = QHttpServerResponder::StatusCode::Ok;
+            reply.headers = {{"Content-Type", "application/json"}, {"Cache-Control", "no-cache"}};
+            reply.body = tileJSONData;
+            return reply;
+        });
+        return true;
+    }
+    int z = 0;
+    int x = 0;
+    int y = 0;
+    if ((firstElement == u"aviationData") && parseTilePath(remainder, z, x, y) && m_aviationTiles)
+    {
+        auto aviationTiles = m_aviationTiles();
+
+        // Tiles without features are served as empty files. While the tiles
+        // are still being generated, the request fails, so that the client
+        // does not take an empty tile for the real thing.
+        replyInWorkerThread(request, socket, [aviationTiles, z, x, y]() {
+            GeoMaps::TileHandler::Reply reply;
+            reply.headers = {{"Cache-Control", "no-cache"}};
+            if (aviationTiles.isNull())
+            {
+                reply.status = QHttpServerResponder::StatusCode::ServiceUnavailable;
+                return reply;
+            }
+            reply.status = QHttpServerResponder::StatusCode::Ok;
+            reply.headers.append({"Content-Type", "application/x-protobuf"});
+            reply.body = aviationTiles->tile(z, x, y);
+            return reply;
+        });
         return true;
     }
 
     //
-    // Tile data
+    // File from resource system
     //
-    if (m_tileHandlers.contains(pathElements[0]))
+    if (m_resourceFiles.contains(path))
     {
-        auto tileHandler = m_tileHandlers[pathElements[0]];
-        if (tileHandler == nullptr)
-        {
-            return false;
-        }
-        pathElements.remove(0);
-        return tileHandler->process(&responder, pathElements);
+        auto responder = makeResponder(request, socket);
+        auto* file = new QFile(":"+path);
+        responder.write(file, "application/octet-stream");
+        return true;
     }
 
     //
@@ -113,6 +443,29 @@ bool GeoMaps::TileServer::handleRequest(const QHttpServerRequest& request, QTcpS
 }
 
 
+void GeoMaps::TileServer::replyInWorkerThread(const QHttpServerRequest& request, QTcpSocket* socket, const std::function<TileHandler::Reply()>& work)
+{
+    // QHttpServerResponder can only be moved, so we keep it in a shared
+    // pointer that is handed from thread to thread.
+    auto responder = std::make_shared<QHttpServerResponder>(makeResponder(request, socket));
+    QPointer<QTcpSocket> socketGuard(socket);
+    auto ifNoneMatch = request.value("If-None-Match");
+    auto ifModifiedSince = request.value("If-Modified-Since");
+
+    m_threadPool.start([this, responder, socketGuard, work, ifNoneMatch, ifModifiedSince]() {
+        auto reply = work();
+        applyValidators(reply, ifNoneMatch, ifModifiedSince);
+        QMetaObject::invokeMethod(this, [responder, socketGuard, reply]() {
+            if (socketGuard.isNull())
+            {
+                return;
+            }
+            writeReply(*responder, reply);
+        }, Qt::QueuedConnection);
+    });
+}
+
+
 void GeoMaps::TileServer::missingHandler(const QHttpServerRequest& request, QTcpSocket* socket)
 {
     auto responder = makeResponder(request, socket);
@@ -20,11 +20,19 @@
 
 #pragma once
 
+#include "geomaps/AviationTiles.h"
 #include "geomaps/MBTILES.h"
+#include "geomaps/TileCache.h"
 #include "geomaps/TileHandler.h"
+#include "units/ByteSize.h"
 
 #include <QAbstractHttpServer>
+#include <QAtomicInteger>
+#include <QGeoCoordinate>
+#include <QSet>
 #include <QSharedPointer>
+#include <QThreadPool>
+#include <functional>
 
 
 namespace GeoMaps {
@@ -37,8 +45,12 @@ namespace GeoMaps {
  *  - If path is a file name, the server checks if the file is available in the
  *    resource system of the app and serves that file.
  *  - If path equals "aviationData.geojson", the server returns a GeoJSON
- *    document that contains the full aviation data, as provided by
- *    GlobalObject::geoMapProvider()->geoJSON().
+ *    document that contains the full aviation data, as provided by the
+ *    function set with setAviationData().
+ *  - If path equals "aviationData.json", the server returns a TileJSON
+ *    document describing the aviation data as vector tiles. Individual tiles
+ *    are served under "aviationData/z/x/y.pbf", as provided by the function
+ *    set with setAviationData().
  *  - If path equals the base name of an MBTilesFileSet, then the server returns
  *    a JSON document describing the MBTiles.
  *  - If path equals "baseName/z/x/y.XXX", then the server returns an individual
@@ -53,6 +65,16 @@ namespace GeoMaps {
  *  with vector tiles containing openstreetmap data and one set with raster data
  *  used for hillshading. Each set contains two MBTiles files, one for Africa
  *  and one for Europe.
+ *
+ *  Raw tile data from MBTiles files is kept in a TileCache, shared between
+ *  all sets of files. Replies carry the validators ETag and, where known,
+ *  Last-Modified, and conditional requests are answered with "304 Not
+ *  Modified" where possible.
+ *
+ *  Requests are routed in the main thread. Tiles are read and encoded in a
+ *  small pool of worker threads, and the replies are sent from the main thread
+ *  once they are ready. On request, the worker threads also load tiles into
+ *  the tile cache ahead of time, see prefetch().
  */
 
 class TileServer : public QAbstractHttpServer
@@ -66,9 +88,11 @@ public:
    *  method serverUrl() returns the precise Url where the server will be
    *  available.
    *
+   *  @param tileCacheSize Initial budget of the tile cache, in bytes
+   *
    *  @param parent The standard QObject parent
    */
-  explicit TileServer(QObject* parent = nullptr);
+  explicit TileServer(Units::ByteSize tileCacheSize, QObject* parent = nullptr);
   
   // Standard destructor
   ~TileServer() override = default;
@@ -83,6 +107,18 @@ public:
    *  @returns URL under which this server is presently reachable
    */
   [[nodiscard]] auto serverUrl() -> QString;
+
+  /*! \brief Cache for tile data
+   *
+   *  This method gives access to the tile cache, mostly in order to read its
+   *  hit counters.
+   *
+   *  @returns Tile cache used by this server
+   */
+  [[nodiscard]] auto tileCache() const -> const TileCache&
+  {
+    return *m_tileCache;
+  }
 			   
 public slots:
   /*! \brief Add a new set of tile files
@@ -106,11 +142,53 @@ public slots:
    */
   void addMbtilesFileSet(const QString& baseName, const QVector<QPointer<GeoMaps::MBTILES>>& MBTilesFiles);
 
+  /*! \brief Set source of aviation data
+   *
+   *  The functions are called in the main thread, whenever a request for
+   *  aviation data comes in. As long as no functions are set, such requests
+   *  are not answered.
+   *
+   *  @param geoJSON Function that returns the aviation data as GeoJSON
+   *
+   *  @param aviationTiles Function that returns the aviation data as vector
+   *  tiles, or a nullptr if the vector tiles are not yet available
+   */
+  void setAviationData(const std::function<QByteArray()>& geoJSON, const std::function<QSharedPointer<GeoMaps::AviationTiles>()>& aviationTiles);
+
   /*! \brief Removes a set of tile files
+   *
+   *  This method waits until all worker threads have finished processing
+   *  pending requests. Once the method returns, the MBTILES files of the set
+   *  are no longer accessed and can safely be deleted.
    *
    *  @param baseName Path of tiles to remove
    */
   void removeMbtilesFileSet(const QString& baseName);
+
+  /*! \brief Sets the memory budget of the tile cache
+   *
+   *  @param size Budget of the tile cache, in bytes
+   */
+  void setTileCacheSize(Units::ByteSize size);
+
+  /*! \brief Load tiles into the tile cache ahead of time
+   *
+   *  For every set of tile files, this method loads the tiles that contain
+   *  the given positions, together with their eight neighbours, into the tile
+   *  cache. This is done for all zoom levels between minZoom and maxZoom that
+   *  the set provides. The tiles are read in the worker threads, with lower
+   *  priority than HTTP requests. Every call to this method cancels
+   *  prefetching that was requested earlier and has not yet been done.
+   *  Prefetching stops early once it has added a quarter of the tile cache
+   *  budget, so that it never evicts the tiles currently shown.
+   *
+   *  @param positions Positions whose tiles shall be loaded
+   *
+   *  @param minZoom Minimal zoom level
+   *
+   *  @param maxZoom Maximal zoom level
+   */
+  void prefetch(const QVector<QGeoCoordinate>& positions, int minZoom, int maxZoom);
   
 private:
   Q_DISABLE_COPY_MOVE(TileServer)
@@ -121,8 +199,43 @@ private:
   // Implemented pure virtual method from QAbstractHttpServer
   void missingHandler(const QHttpServerRequest& request, QTcpSocket* socket) override;
 
+  // Computes the reply to a request in a worker thread, and sends the reply
+  // from the main thread once it is ready. If the socket is closed in the
+  // meantime, the reply is discarded. Successful replies get an ETag, computed
+  // from the content, and are answered with "304 Not Modified" if the
+  // conditional request headers match.
+  void replyInWorkerThread(const QHttpServerRequest& request, QTcpSocket* socket, const std::function<TileHandler::Reply()>& work);
+
   // List of tile handlers
   QMap<QString, QSharedPointer<GeoMaps::TileHandler>> m_tileHandlers;
+
+  // Paths of all files in the resource system, in the form "/dir/file"
+  QSet<QString> m_resourceFiles;
+
+  // Source of aviation data
+  std::function<QByteArray()> m_geoJSON;
+  std::function<QSharedPointer<GeoMaps::AviationTiles>()> m_aviationTiles;
+
+  // Cache for tile data from MBTiles files
+  QSharedPointer<GeoMaps::TileCache> m_tileCache;
+
+  // Number of calls to prefetch(). Prefetching jobs stop once this number
+  // has changed, and before tile sets are removed.
+  QAtomicInteger<quint64> m_prefetchGeneration {0};
+
+  // Maximal number of tiles per tile set and call of prefetch(), and number
+  // of tiles handled by one job in the worker threads
+  static constexpr qsizetype maxPrefetchTiles = 1024;
+  static constexpr qsizetype prefetchBatchSize = 16;
+
+  // One call of prefetch() adds at most this fraction of the tile cache
+  // budget to the cache, split evenly between the tile sets. The remaining
+  // budget keeps the tiles that the map is currently showing.
+  static constexpr qsizetype prefetchBudgetDivisor = 4;
+
+  // Worker threads for tile requests. This member is declared last, so that
+  // the destructor waits for all jobs before other members are destroyed.
+  QThreadPool m_threadPool;
 };
 
 } // namespace GeoMaps
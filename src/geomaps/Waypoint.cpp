@@ -375,3 +375,21 @@ auto GeoMaps::qHash(const GeoMaps::Waypoint& wp) -> size_t
     }
     return result;
 }
+
+
+QDataStream& GeoMaps::operator<<(QDataStream& stream, const GeoMaps::Waypoint& waypoint)
+{
+    stream << waypoint.m_coordinate;
+    stream << waypoint.m_properties;
+
+    return stream;
+}
+
+
+QDataStream& GeoMaps::operator>>(QDataStream& stream, GeoMaps::Waypoint& waypoint)
+{
+    stream >> waypoint.m_coordinate;
+    stream >> waypoint.m_properties;
+
+    return stream;
+}
@@ -20,6 +20,7 @@
 
 #pragma once
 
+#include <QDataStream>
 #include <QGeoCoordinate>
 #include <QJsonObject>
 #include <QMap>
@@ -45,6 +46,9 @@ class Waypoint
     /*! \brief qHash */
     friend auto qHash(const GeoMaps::Waypoint& wp) -> size_t;
 
+    friend QDataStream& operator<<(QDataStream& stream, const GeoMaps::Waypoint& waypoint);
+    friend QDataStream& operator>>(QDataStream& stream, GeoMaps::Waypoint& waypoint);
+
 public:
     /*! \brief Constructs an invalid way point
      *
@@ -381,6 +385,18 @@ protected:
  */
 auto qHash(const GeoMaps::Waypoint& wp) -> size_t;
 
+/*! \brief Serialization
+ *
+ *  There is no checks for errors of any kind.
+ */
+QDataStream& operator<<(QDataStream& stream, const GeoMaps::Waypoint& waypoint);
+
+/*! \brief Deserialization
+ *
+ *  There is no checks for errors of any kind.
+ */
+QDataStream& operator>>(QDataStream& stream, GeoMaps::Waypoint& waypoint);
+
 } // namespace GeoMaps
 
 // Declare meta types
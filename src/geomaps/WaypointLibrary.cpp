@@ -23,15 +23,16 @@
 #include <QJsonDocument>
 #include <QXmlStreamWriter>
 
-#include "Librarian.h"
 #include "geomaps/CUP.h"
 #include "geomaps/GPX.h"
 #include "geomaps/GeoJSON.h"
+#include "geomaps/GeoJSONReader.h"
 #include "geomaps/WaypointLibrary.h"
 
 GeoMaps::WaypointLibrary::WaypointLibrary(QObject *parent)
     : GlobalObject(parent)
 {
+    connect(this, &GeoMaps::WaypointLibrary::waypointsChanged, this, &GeoMaps::WaypointLibrary::rebuildIndex);
     (void)loadFromGeoJSON();
     connect(this, &GeoMaps::WaypointLibrary::waypointsChanged, this, [this]()
     { (void)save(); });
@@ -54,6 +55,16 @@ void GeoMaps::WaypointLibrary::add(const GeoMaps::Waypoint &waypoint)
     emit waypointsChanged();
 }
 
+auto GeoMaps::WaypointLibrary::closestWaypoint(const QGeoCoordinate& position) const -> GeoMaps::Waypoint
+{
+    auto nearest = m_waypointIndex.nearest(position, 1);
+    if (nearest.isEmpty())
+    {
+        return {};
+    }
+    return m_waypoints[nearest[0]];
+}
+
 void GeoMaps::WaypointLibrary::clear()
 {
     if (m_waypoints.isEmpty())
@@ -67,30 +78,32 @@ void GeoMaps::WaypointLibrary::clear()
 
 QVector<GeoMaps::Waypoint> GeoMaps::WaypointLibrary::filteredWaypoints(const QString &filter) const
 {
-    QVector<GeoMaps::Waypoint> result;
+    QStringList filterWords;
+    auto simplifiedFilter = WaypointSearchIndex::normalize(filter);
+    if (!simplifiedFilter.isEmpty())
+    {
+        filterWords << simplifiedFilter;
+    }
+    return matchingWaypoints(filterWords);
+}
 
-    QString simplifiedFilter = GlobalObject::librarian()->simplifySpecialChars(filter);
-    foreach (auto waypoint, m_waypoints)
+auto GeoMaps::WaypointLibrary::matchingWaypoints(const QStringList& filterWords) const -> QVector<GeoMaps::Waypoint>
+{
+    QVector<GeoMaps::Waypoint> result;
+    foreach (auto index, m_searchIndex.search(filterWords))
     {
-        auto simplifiedName = GlobalObject::librarian()->simplifySpecialChars(waypoint.name());
-        if (simplifiedName.contains(simplifiedFilter, Qt::CaseInsensitive))
-        {
-            result.append(waypoint);
-        }
+        result.append(m_waypoints[index]);
     }
     return result;
 }
 
 bool GeoMaps::WaypointLibrary::hasNearbyEntry(const GeoMaps::Waypoint &waypoint) const
 {
-    for (const auto &wp : qAsConst(m_waypoints))
+    if (!waypoint.coordinate().isValid())
     {
-        if (wp.isNear(waypoint))
-        {
-            return true;
-        }
+        return false;
     }
-    return false;
+    return !m_waypointIndex.withinRadius(waypoint.coordinate(), Units::Distance::fromM(2000)).isEmpty();
 }
 
 auto GeoMaps::WaypointLibrary::loadFromGeoJSON(QString fileName) -> QString
@@ -106,30 +119,28 @@ auto GeoMaps::WaypointLibrary::loadFromGeoJSON(QString fileName) -> QString
     {
         return tr("Cannot open file '%1' for reading.").arg(fileName);
     }
-    auto fileContent = file.readAll();
-    if (fileContent.isEmpty())
+    if (file.atEnd())
     {
         return tr("Cannot read data from file '%1'.").arg(fileName);
     }
-    file.close();
-
-    QJsonParseError parseError{};
-    auto document = QJsonDocument::fromJson(fileContent, &parseError);
-    if (parseError.error != QJsonParseError::NoError)
-    {
-        return tr("Cannot parse file '%1'. Reason: %2.").arg(fileName, parseError.errorString());
-    }
 
     QVector<GeoMaps::Waypoint> newWaypoints;
-    foreach (auto value, document.object()[QStringLiteral("features")].toArray())
+    GeoJSONReader reader(&file);
+    QJsonObject object;
+    while (reader.readNextFeature(object))
     {
-        auto wp = GeoMaps::Waypoint(value.toObject());
+        auto wp = GeoMaps::Waypoint(object);
         if (!wp.isValid())
         {
             return tr("Cannot parse content of file '%1'.").arg(fileName);
         }
         newWaypoints.append(wp);
     }
+    if (reader.hasError())
+    {
+        return tr("Cannot parse file '%1'. Reason: %2.").arg(fileName, reader.errorString());
+    }
+    file.close();
 
     m_waypoints = newWaypoints;
     emit waypointsChanged();
@@ -285,3 +296,20 @@ auto GeoMaps::WaypointLibrary::toGpx() const -> QByteArray
 
     return result;
 }
+
+
+//
+// Private Methods
+//
+
+void GeoMaps::WaypointLibrary::rebuildIndex()
+{
+    QVector<QGeoCoordinate> coordinates;
+    coordinates.reserve(m_waypoints.size());
+    for (const auto &wp : qAsConst(m_waypoints))
+    {
+        coordinates.append(wp.coordinate());
+    }
+    m_waypointIndex = KDTree(coordinates);
+    m_searchIndex = WaypointSearchIndex(m_waypoints);
+}
@@ -24,7 +24,9 @@
 #include <QStandardPaths>
 
 #include "GlobalObject.h"
+#include "geomaps/KDTree.h"
 #include "geomaps/Waypoint.h"
+#include "geomaps/WaypointSearchIndex.h"
 
 namespace GeoMaps
 {
@@ -96,6 +98,15 @@ namespace GeoMaps
          */
         Q_INVOKABLE void add(const GeoMaps::Waypoint &waypoint);
 
+        /*! \brief Find the library waypoint closest to a given position
+         *
+         * @param position Position near which waypoints are searched for
+         *
+         * @returns The waypoint in the library that is closest to position, or
+         * an invalid waypoint if the library is empty
+         */
+        [[nodiscard]] Q_INVOKABLE GeoMaps::Waypoint closestWaypoint(const QGeoCoordinate& position) const;
+
         /*! \brief Clears the waypoint library */
         Q_INVOKABLE void clear();
 
@@ -122,6 +133,17 @@ namespace GeoMaps
          */
         [[nodiscard]] Q_INVOKABLE QVector<GeoMaps::Waypoint> filteredWaypoints(const QString &filter) const;
 
+        /*! \brief Lists all entries in the waypoint library that match a list
+         * of words
+         *
+         * @param filterWords List of normalized words, as returned by
+         * WaypointSearchIndex::filterWords()
+         *
+         * @returns All waypoints whose name or ICAO code contains each of the
+         * words, in alphabetical order
+         */
+        [[nodiscard]] auto matchingWaypoints(const QStringList& filterWords) const -> QVector<GeoMaps::Waypoint>;
+
         /*! \brief Check if the library contains a waypoint near to a given one
          *
          *  The method checks proximity with the method GeoMaps::Waypoint::isNear
@@ -230,6 +252,16 @@ namespace GeoMaps
 
         // Acutual list of waypoints.
         QList<GeoMaps::Waypoint> m_waypoints;
+
+        // Rebuilds m_waypointIndex and m_searchIndex. This method is called whenever the list of
+        // waypoints changes.
+        void rebuildIndex();
+
+        // Spatial index for m_waypoints, items are indices into m_waypoints
+        KDTree m_waypointIndex;
+
+        // Search index for m_waypoints, items are indices into m_waypoints
+        WaypointSearchIndex m_searchIndex;
     };
 
 } // namespace GeoMaps
@@ -0,0 +1,144 @@
+/***************************************************************************
+ *   Copyright (C) 2023 by Stefan Kebekus                                  *
+ *   stefan.kebekus@gmail.com                                              *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 3 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, write to the                         *
+ *   Free Software Foundation, Inc.,                                       *
+ *   59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.             *
+ ***************************************************************************/
+
+
+#include "Librarian.h"
+#include "geomaps/WaypointSearchIndex.h"
+
+
+GeoMaps::WaypointSearchIndex::WaypointSearchIndex(const QVector<GeoMaps::Waypoint>& waypoints)
+{
+    m_names.reserve(waypoints.size());
+    m_codes.reserve(waypoints.size());
+    for(qsizetype index=0; index<waypoints.size(); index++)
+    {
+        const auto& waypoint = waypoints[index];
+        m_names.append(normalize(waypoint.name()));
+        m_codes.append(normalize(waypoint.ICAOCode()));
+
+        // Add trigrams of name and code. Since the index is increasing, it
+        // suffices to compare with the last element to avoid duplicates.
+        for(const auto& string : {m_names.last(), m_codes.last()})
+        {
+            for(qsizetype i=0; i+3<=string.size(); i++)
+            {
+                auto& postings = m_trigrams[trigramKey(string, i)];
+                if (postings.isEmpty() || (postings.last() != index))
+                {
+                    postings.append(index);
+                }
+            }
+        }
+    }
+}
+
+
+auto GeoMaps::WaypointSearchIndex::filterWords(const QString& filter) -> QStringList
+{
+    QStringList result;
+    foreach(auto word, filter.simplified().split(' ', Qt::SkipEmptyParts))
+    {
+        auto normalizedWord = normalize(word);
+        if (normalizedWord.isEmpty())
+        {
+            continue;
+        }
+        result.append(normalizedWord);
+    }
+    return result;
+}
+
+
+auto GeoMaps::WaypointSearchIndex::normalize(const QString& string) -> QString
+{
+    return Librarian::simplifySpecialCharsUncached(string).toLower();
+}
+
+
+auto GeoMaps::WaypointSearchIndex::search(const QStringList& words) const -> QVector<qsizetype>
+{
+    //
+    // Find candidates. For every word of length three or more, the waypoints
+    // that match are among those that contain all trigrams of the word. We
+    // take the word whose rarest trigram has the shortest list.
+    //
+    const QVector<qsizetype>* shortestPostings = nullptr;
+    foreach(auto word, words)
+    {
+        for(qsizetype i=0; i+3<=word.size(); i++)
+        {
+            auto iterator = m_trigrams.constFind(trigramKey(word, i));
+            if (iterator == m_trigrams.constEnd())
+            {
+                // Trigram does not occur anywhere, so nothing can match.
+                return {};
+            }
+            if ((shortestPostings == nullptr) || (iterator->size() < shortestPostings->size()))
+            {
+                shortestPostings = &iterator.value();
+            }
+        }
+    }
+
+    //
+    // Check candidates
+    //
+    auto matches = [&](qsizetype index) {
+        foreach(auto word, words)
+        {
+            if (!m_names[index].contains(word) && !m_codes[index].contains(word))
+            {
+                return false;
+            }
+        }
+        return true;
+    };
+
+    QVector<qsizetype> result;
+    if (shortestPostings != nullptr)
+    {
+        for(auto index : *shortestPostings)
+        {
+            if (matches(index))
+            {
+                result.append(index);
+            }
+        }
+        return result;
+    }
+
+    // Only short words, or no words at all. Check all waypoints.
+    for(qsizetype index=0; index<m_names.size(); index++)
+    {
+        if (matches(index))
+        {
+            result.append(index);
+        }
+    }
+    return result;
+}
+
+
+auto GeoMaps::WaypointSearchIndex::trigramKey(const QString& string, qsizetype i) -> quint64
+{
+    return (static_cast<quint64>(string[i].unicode()) << 32)
+           | (static_cast<quint64>(string[i+1].unicode()) << 16)
+           | static_cast<quint64>(string[i+2].unicode());
+}
@@ -0,0 +1,107 @@
+/***************************************************************************
+ *   Copyright (C) 2023 by Stefan Kebekus                                  *
+ *   stefan.kebekus@gmail.com                                              *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 3 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, write to the                         *
+ *   Free Software Foundation, Inc.,                                       *
+ *   59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.             *
+ ***************************************************************************/
+
+
+#pragma once
+
+#include <QHash>
+#include <QStringList>
+#include <QVector>
+
+#include "geomaps/Waypoint.h"
+
+namespace GeoMaps {
+
+/*! \brief Full-text search index for waypoints
+ *
+ *  This class holds normalized versions of the names and ICAO codes of a list
+ *  of waypoints, together with an inverted index that maps every trigram
+ *  (=sequence of three consecutive characters) to the waypoints whose name or
+ *  code contains it. This allows to find waypoints matching a search string
+ *  without looking at every waypoint, and without normalizing any waypoint
+ *  name at search time.
+ *
+ *  The index is built once, in the constructor, and cannot be modified
+ *  afterwards.  Query results are indices into the list of waypoints that was
+ *  handed over to the constructor.
+ *
+ *  Instances of this class are immutable and can therefore be used from
+ *  several threads at the same time.
+ */
+
+class WaypointSearchIndex {
+
+public:
+    /*! \brief Constructs an empty index */
+    WaypointSearchIndex() = default;
+
+    /*! \brief Constructs an index for a list of waypoints
+     *
+     *  @param waypoints List of waypoints. The query methods of this class
+     *  return indices into this list.
+     */
+    explicit WaypointSearchIndex(const QVector<GeoMaps::Waypoint>& waypoints);
+
+    /*! \brief Split a search string into normalized words
+     *
+     *  @param filter Search string, as entered by the user
+     *
+     *  @returns List of normalized, non-empty words, suitable as an argument
+     *  for search()
+     */
+    [[nodiscard]] static auto filterWords(const QString& filter) -> QStringList;
+
+    /*! \brief Normalize a string for searching
+     *
+     *  Special characters are simplified, all characters other than letters
+     *  and digits are removed and the string is converted to lower case.  For
+     *  instance, "Düsseldorf-Süd" becomes "dusseldorfsud".
+     *
+     *  @param string Input string
+     *
+     *  @returns Normalized string
+     */
+    [[nodiscard]] static auto normalize(const QString& string) -> QString;
+
+    /*! \brief Find waypoints matching a list of words
+     *
+     *  @param words List of normalized words, as returned by filterWords()
+     *
+     *  @returns Indices of all waypoints whose normalized name or ICAO code
+     *  contains each of the words, in ascending order. If the list of words is
+     *  empty, all waypoints are returned.
+     */
+    [[nodiscard]] auto search(const QStringList& words) const -> QVector<qsizetype>;
+
+private:
+    // Key for a trigram that starts at position i of the string
+    static auto trigramKey(const QString& string, qsizetype i) -> quint64;
+
+    // Normalized names and ICAO codes of the waypoints
+    QVector<QString> m_names;
+    QVector<QString> m_codes;
+
+    // Maps trigrams to the indices of all waypoints whose normalized name or
+    // ICAO code contains the trigram. The lists are sorted in ascending order
+    // and do not contain duplicates.
+    QHash<quint64, QVector<qsizetype>> m_trigrams;
+};
+
+} // namespace GeoMaps
@@ -20,10 +20,12 @@
 
 #include <QJsonArray>
 #include <QStandardPaths>
+#include <QtConcurrent>
 
 #include "FlightRoute.h"
 #include "GlobalObject.h"
 #include "geomaps/GeoJSON.h"
+#include "geomaps/GeoMapProvider.h"
 #include "navigation/Navigator.h"
 
 
@@ -43,6 +45,8 @@ Navigation::FlightRoute::FlightRoute(QObject *parent)
 
     connect(this, &FlightRoute::waypointsChanged, this, &Navigation::FlightRoute::saveToStdLocation);
     connect(this, &FlightRoute::waypointsChanged, this, &Navigation::FlightRoute::summaryChanged);
+    connect(this, &FlightRoute::waypointsChanged, this, &Navigation::FlightRoute::updateTerrainProfile);
+    connect(GlobalObject::geoMapProvider(), &GeoMaps::GeoMapProvider::terrainMapTilesChanged, this, &Navigation::FlightRoute::updateTerrainProfile);
     connect(GlobalObject::navigator(), &Navigation::Navigator::aircraftChanged, this, &Navigation::FlightRoute::summaryChanged);
     connect(GlobalObject::navigator(), &Navigation::Navigator::windChanged, this, &Navigation::FlightRoute::summaryChanged);
 }
@@ -502,3 +506,54 @@ void Navigation::FlightRoute::updateLegs()
     }
 }
 
+
+void Navigation::FlightRoute::requestTerrainProfile(Units::Distance spacing, Units::Distance corridorHalfWidth, Units::Distance clearance)
+{
+    if (m_terrainProfileRequested
+            && (spacing == m_terrainProfileSpacing)
+            && (corridorHalfWidth == m_terrainProfileCorridorHalfWidth)
+            && (clearance == m_terrainProfileClearance))
+    {
+        return;
+    }
+
+    m_terrainProfileRequested = true;
+    m_terrainProfileSpacing = spacing;
+    m_terrainProfileCorridorHalfWidth = corridorHalfWidth;
+    m_terrainProfileClearance = clearance;
+    updateTerrainProfile();
+}
+
+
+void Navigation::FlightRoute::updateTerrainProfile()
+{
+    m_terrainProfileGeneration++;
+    if (m_terrainProfile.isValid())
+    {
+        m_terrainProfile = {};
+        emit terrainProfileChanged();
+    }
+    if (!m_terrainProfileRequested)
+    {
+        return;
+    }
+
+    // TerrainElevation is thread-safe. The shared pointer keeps it alive
+    // while the profile is computed, even if the GeoMapProvider is deleted in
+    // the meantime.
+    auto terrainElevation = GlobalObject::geoMapProvider()->terrainElevation();
+    auto elevation = [terrainElevation](const QGeoCoordinate& coordinate) {
+        return terrainElevation->elevationAMSL(coordinate);
+    };
+
+    auto generation = m_terrainProfileGeneration;
+    QtConcurrent::run(&TerrainProfile::compute, elevation, m_legs, m_terrainProfileSpacing, m_terrainProfileCorridorHalfWidth, m_terrainProfileClearance)
+            .then(this, [this, generation](const Navigation::TerrainProfile& profile) {
+                if (generation != m_terrainProfileGeneration)
+                {
+                    return;
+                }
+                m_terrainProfile = profile;
+                emit terrainProfileChanged();
+            });
+}
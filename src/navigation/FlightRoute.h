@@ -30,6 +30,7 @@
 
 #include "geomaps/Waypoint.h"
 #include "navigation/Leg.h"
+#include "navigation/TerrainProfile.h"
 
 namespace GeoMaps
 {
@@ -122,6 +123,16 @@ namespace Navigation
          */
         Q_PROPERTY(QString summary READ summary NOTIFY summaryChanged)
 
+        /*! \brief Terrain profile along the route
+         *
+         *  This property holds the terrain profile that was last requested with
+         *  requestTerrainProfile(). The profile is computed in a separate
+         *  thread. While the computation runs, and whenever the waypoints
+         *  change, the property holds an invalid profile. After a change of
+         *  the waypoints, the profile is recomputed automatically.
+         */
+        Q_PROPERTY(Navigation::TerrainProfile terrainProfile READ terrainProfile NOTIFY terrainProfileChanged)
+
         /*! \brief List of waypoints in the flight route that are not airfields
          *
          * This property lists all the waypoints in the route that are not
@@ -169,6 +180,12 @@ namespace Navigation
          */
         [[nodiscard]] auto summary() const -> QString;
 
+        /*! \brief Getter function for the property with the same name
+         *
+         *  @returns Property terrainProfile
+         */
+        [[nodiscard]] auto terrainProfile() const -> Navigation::TerrainProfile { return m_terrainProfile; }
+
         /*! \brief Getter function for the property with the same name
          *
          * @returns Property waypoints
@@ -337,6 +354,23 @@ namespace Navigation
          */
         Q_INVOKABLE [[nodiscard]] QByteArray toGpx() const;
 
+        /*! \brief Request terrain profile
+         *
+         *  This method starts computation of the terrain profile in a separate
+         *  thread and returns immediately. Once the computation is finished,
+         *  the property terrainProfile is updated. If a profile with the same
+         *  parameters has already been requested, this method does nothing.
+         *
+         *  @param spacing Distance between two samples along the route
+         *
+         *  @param corridorHalfWidth Half width of the corridor around the
+         *  route that is taken into account
+         *
+         *  @param clearance Vertical clearance used to compute minimum safe
+         *  altitudes
+         */
+        Q_INVOKABLE void requestTerrainProfile(Units::Distance spacing, Units::Distance corridorHalfWidth, Units::Distance clearance = Units::Distance::fromFT(1000));
+
     signals:
         /*! \brief Notification signal for the property with the same name */
         void waypointsChanged();
@@ -344,6 +378,9 @@ namespace Navigation
         /*! \brief Notification signal for the property with the same name */
         void summaryChanged();
 
+        /*! \brief Notification signal for the property with the same name */
+        void terrainProfileChanged();
+
     private slots:
         // Saves the route into the file stdFileName. This slot is called
         // whenever the route changes, so that the file will always contain the
@@ -352,6 +389,11 @@ namespace Navigation
 
         void updateLegs();
 
+        // Starts computation of the terrain profile with the parameters given
+        // in the last call to requestTerrainProfile(), if any. This slot is
+        // called whenever the route changes.
+        void updateTerrainProfile();
+
     private:
         Q_DISABLE_COPY_MOVE(FlightRoute)
 
@@ -368,6 +410,16 @@ namespace Navigation
 
         QVector<Leg> m_legs;
 
+        // Terrain profile, the parameters last passed to
+        // requestTerrainProfile(), and a counter that is used to discard
+        // results of computations that have become obsolete.
+        TerrainProfile m_terrainProfile;
+        bool m_terrainProfileRequested {false};
+        Units::Distance m_terrainProfileSpacing;
+        Units::Distance m_terrainProfileCorridorHalfWidth;
+        Units::Distance m_terrainProfileClearance;
+        quint64 m_terrainProfileGeneration {0};
+
         QLocale myLocale;
     };
 
@@ -0,0 +1,163 @@
+/***************************************************************************
+ *   Copyright (C) 2023 by Stefan Kebekus                                  *
+ *   stefan.kebekus@gmail.com                                              *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 3 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, write to the                         *
+ *   Free Software Foundation, Inc.,                                       *
+ *   59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.             *
+ ***************************************************************************/
+
+#include <QtMath>
+
+#include "navigation/TerrainProfile.h"
+
+
+//
+// Getter Methods
+//
+
+auto Navigation::TerrainProfile::maximumElevation() const -> Units::Distance
+{
+    auto result = qQNaN();
+    foreach(auto leg, m_legs)
+    {
+        if (qIsFinite(leg.maximumElevation) && !(result >= leg.maximumElevation))
+        {
+            result = leg.maximumElevation;
+        }
+    }
+    return Units::Distance::fromM(result);
+}
+
+
+auto Navigation::TerrainProfile::minimumSafeAltitude() const -> Units::Distance
+{
+    return maximumElevation() + m_clearance;
+}
+
+
+//
+// Methods
+//
+
+auto Navigation::TerrainProfile::compute(const std::function<Units::Distance(const QGeoCoordinate&)>& elevation, const QVector<Navigation::Leg>& legs, Units::Distance spacing, Units::Distance corridorHalfWidth, Units::Distance clearance) -> Navigation::TerrainProfile
+{
+    TerrainProfile result;
+    if (!spacing.isFinite() || (spacing.toM() <= 0.0) || !clearance.isFinite())
+    {
+        return result;
+    }
+    auto halfWidth = corridorHalfWidth.isFinite() ? qMax(0.0, corridorHalfWidth.toM()) : 0.0;
+    result.m_clearance = clearance;
+
+    double distanceFromStart = 0.0;
+    foreach(auto leg, legs)
+    {
+        LegStatistics statistics;
+        if (!leg.isValid())
+        {
+            result.m_legs.append(statistics);
+            continue;
+        }
+
+        auto start = leg.startPoint().coordinate();
+        auto end = leg.endPoint().coordinate();
+        auto length = start.distanceTo(end);
+        auto azimuth = start.azimuthTo(end);
+        auto step = qMax(spacing.toM(), length/maxSamplesPerLeg);
+        auto numSteps = qMax(1, qCeil(length/step));
+
+        for(int i=0; i<=numSteps; i++)
+        {
+            auto distance = length*i/numSteps;
+            auto terrain = sampleCorridor(elevation, start.atDistanceAndAzimuth(distance, azimuth), azimuth, step, halfWidth);
+
+            // The first sample of a leg is the last sample of the previous one
+            if ((i > 0) || result.m_profile.isEmpty())
+            {
+                result.m_profile.append(QPointF(distanceFromStart+distance, terrain));
+            }
+            if (!qIsFinite(terrain))
+            {
+                continue;
+            }
+            if (!(statistics.minimumElevation <= terrain))
+            {
+                statistics.minimumElevation = terrain;
+            }
+            if (!(statistics.maximumElevation >= terrain))
+            {
+                statistics.maximumElevation = terrain;
+            }
+        }
+
+        result.m_legs.append(statistics);
+        distanceFromStart += length;
+    }
+
+    return result;
+}
+
+
+auto Navigation::TerrainProfile::legMinimumElevation(int leg) const -> Units::Distance
+{
+    if ((leg < 0) || (leg >= m_legs.size()))
+    {
+        return {};
+    }
+    return Units::Distance::fromM(m_legs[leg].minimumElevation);
+}
+
+
+auto Navigation::TerrainProfile::legMaximumElevation(int leg) const -> Units::Distance
+{
+    if ((leg < 0) || (leg >= m_legs.size()))
+    {
+        return {};
+    }
+    return Units::Distance::fromM(m_legs[leg].maximumElevation);
+}
+
+
+auto Navigation::TerrainProfile::legMinimumSafeAltitude(int leg) const -> Units::Distance
+{
+    return legMaximumElevation(leg) + m_clearance;
+}
+
+
+auto Navigation::TerrainProfile::sampleCorridor(const std::function<Units::Distance(const QGeoCoordinate&)>& elevation, const QGeoCoordinate& position, double azimuth, double step, double corridorHalfWidth) -> double
+{
+    auto result = elevation(position).toM();
+    if (corridorHalfWidth <= 0.0)
+    {
+        return result;
+    }
+
+    // Sample across the route, on both sides, at the same spacing as along the
+    // route. The outermost samples lie exactly on the boundary.
+    auto numSteps = qMax(1, qCeil(corridorHalfWidth/step));
+    for(int i=1; i<=numSteps; i++)
+    {
+        auto offset = corridorHalfWidth*i/numSteps;
+        for(auto direction : {azimuth-90.0, azimuth+90.0})
+        {
+            auto terrain = elevation(position.atDistanceAndAzimuth(offset, direction)).toM();
+            if (qIsFinite(terrain) && !(result >= terrain))
+            {
+                result = terrain;
+            }
+        }
+    }
+    return result;
+}
@@ -0,0 +1,185 @@
+/***************************************************************************
+ *   Copyright (C) 2023 by Stefan Kebekus                                  *
+ *   stefan.kebekus@gmail.com                                              *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 3 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, write to the                         *
+ *   Free Software Foundation, Inc.,                                       *
+ *   59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.             *
+ ***************************************************************************/
+
+#pragma once
+
+#include <QPointF>
+#include <QQmlEngine>
+#include <functional>
+
+#include "navigation/Leg.h"
+#include "units/Distance.h"
+
+
+namespace Navigation {
+
+/*! \brief Vertical terrain profile along a flight route
+ *
+ *  This class holds terrain elevation, sampled along the legs of a flight
+ *  route at regular spacing. Optionally, the terrain is sampled in a corridor
+ *  around the route, and every sample holds the highest elevation found
+ *  across the corridor. For every leg, the class provides the minimal and
+ *  maximal terrain elevation, as well as a minimum safe altitude, which is the
+ *  maximal elevation plus a clearance.
+ *
+ *  Profiles are computed by the static method compute(), which takes some
+ *  time for long routes and is meant to be run in a separate thread.
+ */
+
+class TerrainProfile {
+    Q_GADGET
+    QML_VALUE_TYPE(terrainProfile)
+
+public:
+    //
+    // PROPERTIES
+    //
+
+    /*! \brief Validity
+     *
+     *  A profile is valid if it has been computed for a route with at least
+     *  one leg.
+     */
+    Q_PROPERTY(bool isValid READ isValid CONSTANT)
+
+    /*! \brief Highest terrain elevation along the route */
+    Q_PROPERTY(Units::Distance maximumElevation READ maximumElevation CONSTANT)
+
+    /*! \brief Highest minimum safe altitude along the route */
+    Q_PROPERTY(Units::Distance minimumSafeAltitude READ minimumSafeAltitude CONSTANT)
+
+    /*! \brief Terrain profile
+     *
+     *  This property holds a list of points. The x coordinate of each point is
+     *  the distance from the start of the route, the y coordinate is the
+     *  terrain elevation, both in meters. The y coordinate is NaN where the
+     *  terrain elevation is unknown.
+     */
+    Q_PROPERTY(QList<QPointF> profile READ profile CONSTANT)
+
+
+    //
+    // Getter Methods
+    //
+
+    /*! \brief Getter function for property of the same name
+     *
+     * @returns Property isValid
+     */
+    [[nodiscard]] auto isValid() const -> bool { return !m_legs.isEmpty(); }
+
+    /*! \brief Getter function for property of the same name
+     *
+     * @returns Property maximumElevation
+     */
+    [[nodiscard]] auto maximumElevation() const -> Units::Distance;
+
+    /*! \brief Getter function for property of the same name
+     *
+     * @returns Property minimumSafeAltitude
+     */
+    [[nodiscard]] auto minimumSafeAltitude() const -> Units::Distance;
+
+    /*! \brief Getter function for property of the same name
+     *
+     * @returns Property profile
+     */
+    [[nodiscard]] auto profile() const -> QList<QPointF> { return m_profile; }
+
+
+    //
+    // Methods
+    //
+
+    /*! \brief Compute terrain profile
+     *
+     *  This method samples terrain elevation along the legs. It is
+     *  thread-safe, provided that the elevation function is. To keep the
+     *  computation time bounded, the spacing is increased for very long legs.
+     *
+     *  @param elevation Function that returns the terrain elevation at a
+     *  given coordinate, or NaN if unknown. Typically, this calls
+     *  GeoMaps::GeoMapProvider::terrainElevationAMSL().
+     *
+     *  @param legs Legs of the flight route
+     *
+     *  @param spacing Distance between two samples along the route
+     *
+     *  @param corridorHalfWidth Half width of the corridor around the route.
+     *  If zero, only the route itself is sampled.
+     *
+     *  @param clearance Vertical clearance added to the maximal terrain
+     *  elevation in order to obtain the minimum safe altitude
+     *
+     *  @returns Terrain profile, or an invalid profile if the parameters are
+     *  invalid
+     */
+    static auto compute(const std::function<Units::Distance(const QGeoCoordinate&)>& elevation, const QVector<Navigation::Leg>& legs, Units::Distance spacing, Units::Distance corridorHalfWidth, Units::Distance clearance) -> Navigation::TerrainProfile;
+
+    /*! \brief Lowest terrain elevation along a leg
+     *
+     *  @param leg Index of the leg
+     *
+     *  @returns Elevation, or NaN if the index is invalid or the elevation is
+     *  unknown
+     */
+    Q_INVOKABLE [[nodiscard]] Units::Distance legMinimumElevation(int leg) const;
+
+    /*! \brief Highest terrain elevation along a leg
+     *
+     *  @param leg Index of the leg
+     *
+     *  @returns Elevation, or NaN if the index is invalid or the elevation is
+     *  unknown
+     */
+    Q_INVOKABLE [[nodiscard]] Units::Distance legMaximumElevation(int leg) const;
+
+    /*! \brief Minimum safe altitude along a leg
+     *
+     *  @param leg Index of the leg
+     *
+     *  @returns Highest terrain elevation plus clearance, or NaN if the index
+     *  is invalid or the elevation is unknown
+     */
+    Q_INVOKABLE [[nodiscard]] Units::Distance legMinimumSafeAltitude(int leg) const;
+
+private:
+    // Maximal number of samples along one leg
+    static constexpr int maxSamplesPerLeg = 10000;
+
+    // Highest terrain elevation in the corridor across the route at a given
+    // position, in meters, or NaN if unknown
+    static auto sampleCorridor(const std::function<Units::Distance(const QGeoCoordinate&)>& elevation, const QGeoCoordinate& position, double azimuth, double step, double corridorHalfWidth) -> double;
+
+    // Terrain statistics of one leg, in meters. NaN if unknown.
+    struct LegStatistics {
+        double minimumElevation {qQNaN()};
+        double maximumElevation {qQNaN()};
+    };
+
+    QVector<LegStatistics> m_legs;
+    QList<QPointF> m_profile;
+    Units::Distance m_clearance;
+};
+
+} // namespace Navigation
+
+// Declare meta types
+Q_DECLARE_METATYPE(Navigation::TerrainProfile)
@@ -330,6 +330,30 @@ Page {
                 }
             }
 
+            WordWrappingItemDelegate {
+                id: trafficTargets
+                text: qsTr("Traffic Targets") +
+                      `<br><font color="#606060" size="2">` +
+                      qsTr("Currently showing up to %1 aircraft").arg(GlobalSettings.trafficTargets) +
+                      `</font>`
+                icon.source: "/icons/material/ic_airplanemode_active.svg"
+                Layout.fillWidth: true
+                onClicked: {
+                    PlatformAdaptor.vibrateBrief()
+                    trafficTargetsDialog.open()
+                }
+            }
+            ToolButton {
+                icon.source: "/icons/material/ic_info_outline.svg"
+                onClicked: {
+                    PlatformAdaptor.vibrateBrief()
+                    helpDialog.title = qsTr("Traffic Targets")
+                    helpDialog.text = "<p>" + qsTr("Traffic data receivers can report a large number of aircraft, in particular near busy airfields or when used together with a flight simulator. Enroute Flight Navigation shows only the most relevant traffic targets, giving priority to aircraft that trigger a traffic warning and to aircraft nearby.") + "</p>"
+                            + "<p>" + qsTr("Use this settings item to choose how many traffic targets are shown. Higher numbers might slow down the moving map on older devices.") + "</p>"
+                    helpDialog.open()
+                }
+            }
+
             WordWrappingSwitchDelegate {
                 id: ignoreSSL
                 text: qsTr("Ignore Network Security Errors")
@@ -552,6 +576,42 @@ Page {
         }
     }
 
+    CenteringDialog {
+        id: trafficTargetsDialog
+
+        modal: true
+        title: qsTr("Traffic Targets")
+        standardButtons: Dialog.Ok|Dialog.Cancel
+
+        ColumnLayout {
+            width: trafficTargetsDialog.availableWidth
+
+            Label {
+                text: qsTr("Choose the maximal number of traffic targets shown on the moving map.")
+                Layout.fillWidth: true
+                wrapMode: Text.Wrap
+            }
+
+            Slider {
+                id: trafficTargetsSlider
+                Layout.fillWidth: true
+                from: GlobalSettings.trafficTargets_min
+                to: GlobalSettings.trafficTargets_max
+                stepSize: 5
+                snapMode: Slider.SnapAlways
+            }
+
+            Label {
+                text: qsTr("Show up to %1 aircraft.").arg(trafficTargetsSlider.value)
+                Layout.fillWidth: true
+                wrapMode: Text.Wrap
+            }
+        }
+
+        onAccepted: GlobalSettings.trafficTargets = trafficTargetsSlider.value
+        onAboutToShow: trafficTargetsSlider.value = GlobalSettings.trafficTargets
+    }
+
     CenteringDialog {
         id: heightLimitDialog
 
@@ -23,6 +23,7 @@
 #include <chrono>
 
 #include "GlobalObject.h"
+#include "GlobalSettings.h"
 #include "platform/PlatformAdaptor_Abstract.h"
 #include "traffic/TrafficDataProvider.h"
 #include "traffic/TrafficDataSource_Tcp.h"
@@ -35,17 +36,17 @@ using namespace std::chrono_literals;
 
 Traffic::TrafficDataProvider::TrafficDataProvider(QObject *parent) : Positioning::PositionInfoSource_Abstract(parent) {
 
-    // Create traffic objects
-    int numTrafficObjects = 20;
-    m_trafficObjects.reserve(numTrafficObjects);
-    for(int i = 0; i<numTrafficObjects; i++)
-    {
-        auto *trafficObject = new Traffic::TrafficFactor_WithPosition(this);
-        QQmlEngine::setObjectOwnership(trafficObject, QQmlEngine::CppOwnership);
-        m_trafficObjects.append( trafficObject );
-    }
+    // Setup publishing of traffic objects
+    m_publishTimer.setInterval(publishInterval);
+    m_publishTimer.setSingleShot(true);
+    connect(&m_publishTimer, &QTimer::timeout, this, &Traffic::TrafficDataProvider::publishTrafficObjects);
+
+    // Create traffic objects. The number is adjusted to the user's setting
+    // in deferredInitialization().
+    setNumTrafficObjects(GlobalSettings::trafficTargets_default);
     m_trafficObjectWithoutPosition = new Traffic::TrafficFactor_DistanceOnly(this);
     QQmlEngine::setObjectOwnership(m_trafficObjectWithoutPosition, QQmlEngine::CppOwnership);
+    m_trafficTargetWithoutPosition = new Traffic::TrafficFactor_DistanceOnly(this);
 
     setSourceName(tr("Traffic data receiver"));
 
@@ -133,10 +134,14 @@ void Traffic::TrafficDataProvider::connectToTrafficReceiver()
 }
 
 
-void Traffic::TrafficDataProvider::deferredInitialization() const
+void Traffic::TrafficDataProvider::deferredInitialization()
 {
     // Try to (re)connect whenever the network situation changes
     connect(GlobalObject::platformAdaptor(), &Platform::PlatformAdaptor_Abstract::wifiConnected, this, &Traffic::TrafficDataProvider::connectToTrafficReceiver);
+
+    // Number of traffic objects
+    connect(GlobalObject::globalSettings(), &GlobalSettings::trafficTargetsChanged, this, [this]() { setNumTrafficObjects(GlobalObject::globalSettings()->trafficTargets()); });
+    setNumTrafficObjects(GlobalObject::globalSettings()->trafficTargets());
 }
 
 
@@ -257,18 +262,23 @@ void Traffic::TrafficDataProvider::onSourceHeartbeatChanged()
 void Traffic::TrafficDataProvider::onTrafficFactorWithoutPosition(const Traffic::TrafficFactor_DistanceOnly &factor)
 {
 
-    if (factor.ID() == m_trafficObjectWithoutPosition->ID())
+    if (factor.ID() == m_trafficTargetWithoutPosition->ID())
+    {
+        m_trafficTargetWithoutPosition->copyFrom(factor);
+        m_trafficTargetWithoutPosition->startLiveTime();
+        m_publishStateWithoutPosition = qMax(m_publishStateWithoutPosition, Updated);
+    }
+
+    if (factor.hasHigherPriorityThan(*m_trafficTargetWithoutPosition))
     {
-        m_trafficObjectWithoutPosition->setAnimate(true);
-        m_trafficObjectWithoutPosition->copyFrom(factor);
-        m_trafficObjectWithoutPosition->startLiveTime();
+        m_trafficTargetWithoutPosition->copyFrom(factor);
+        m_trafficTargetWithoutPosition->startLiveTime();
+        m_publishStateWithoutPosition = Replaced;
     }
 
-    if (factor.hasHigherPriorityThan(*m_trafficObjectWithoutPosition))
+    if ((m_publishStateWithoutPosition != Unchanged) && !m_publishTimer.isActive())
     {
-        m_trafficObjectWithoutPosition->setAnimate(false);
-        m_trafficObjectWithoutPosition->copyFrom(factor);
-        m_trafficObjectWithoutPosition->startLiveTime();
+        m_publishTimer.start();
     }
 
 }
@@ -290,49 +300,72 @@ void Traffic::TrafficDataProvider::onTrafficFactorWithPosition(const Traffic::Tr
 
 
     // Check if the traffic is one of the known factors.
-    foreach(auto target, m_trafficObjects)
+    auto slot = m_slotByID.value(factor.ID(), -1);
+    if (slot >= 0)
     {
-        if (factor.ID() == target->ID())
+        auto* target = m_trafficTargets.at(slot);
+
+        // If traffic is too far away, delete the entry. Otherwise, replace the entry by the factor.
+        if (farAway)
         {
-            // If traffic is too far away, delete the entry. Otherwise, replace the entry by the factor.
-            if (farAway)
-            {
-                target->setAnimate(false);
-                target->copyFrom(TrafficFactor_WithPosition());
-            }
-            else
-            {
-                target->setAnimate(true);
-                target->copyFrom(factor);
-                target->startLiveTime();
-            }
-            return;
+            m_slotByID.remove(factor.ID());
+            target->copyFrom(TrafficFactor_WithPosition());
+            markForPublishing(slot, Replaced);
+        }
+        else
+        {
+            target->copyFrom(factor);
+            target->startLiveTime();
+            markForPublishing(slot, Updated);
         }
+        updateSlotHeap(slot);
+        return;
     }
 
     // If traffic is too far away, ignore the factor.
-    if (farAway) {
+    if (farAway || m_slotHeap.isEmpty())
+    {
         return;
     }
 
-    auto *lowestPriObject = m_trafficObjects.at(0);
-    foreach(auto target, m_trafficObjects)
+    // Replace the traffic object of lowest priority, if the factor has higher
+    // priority
+    slot = m_slotHeap.constFirst();
+    auto *lowestPriObject = m_trafficTargets.at(slot);
+    if (factor.hasHigherPriorityThan(*lowestPriObject))
     {
-        if (lowestPriObject->hasHigherPriorityThan(*target))
+        if (m_slotByID.value(lowestPriObject->ID(), -1) == slot)
         {
-            lowestPriObject = target;
+            m_slotByID.remove(lowestPriObject->ID());
         }
-    }
-    if (factor.hasHigherPriorityThan(*lowestPriObject))
-    {
-        lowestPriObject->setAnimate(false);
         lowestPriObject->copyFrom(factor);
         lowestPriObject->startLiveTime();
+        m_slotByID.insert(factor.ID(), slot);
+        markForPublishing(slot, Replaced);
+        updateSlotHeap(slot);
     }
 
 }
 
 
+auto Traffic::TrafficDataProvider::hasLowerPriority(qsizetype slotA, qsizetype slotB) const -> bool
+{
+    const auto& objectA = *m_trafficTargets.at(slotA);
+    const auto& objectB = *m_trafficTargets.at(slotB);
+    return objectB.hasHigherPriorityThan(objectA) && !objectA.hasHigherPriorityThan(objectB);
+}
+
+
+void Traffic::TrafficDataProvider::markForPublishing(qsizetype slot, PublishState state)
+{
+    m_publishStates[slot] = qMax(m_publishStates.at(slot), state);
+    if (!m_publishTimer.isActive())
+    {
+        m_publishTimer.start();
+    }
+}
+
+
 void Traffic::TrafficDataProvider::onTrafficReceiverRuntimeError(const QString& msg)
 {
     Q_UNUSED(msg);
@@ -387,6 +420,42 @@ void Traffic::TrafficDataProvider::onTrafficReceiverSelfTestError(const QString&
 }
 
 
+void Traffic::TrafficDataProvider::publishTrafficObjects()
+{
+    // Copy all changed targets to the traffic objects. Traffic objects that
+    // now describe a different aircraft must not be animated.
+    for(qsizetype slot = 0; slot < m_trafficObjects.size(); slot++)
+    {
+        auto state = m_publishStates.at(slot);
+        if (state == Unchanged)
+        {
+            continue;
+        }
+        m_publishStates[slot] = Unchanged;
+
+        auto* target = m_trafficTargets.at(slot);
+        auto* trafficObject = m_trafficObjects.at(slot);
+        trafficObject->setAnimate(state == Updated);
+        trafficObject->copyFrom(*target);
+        if (target->valid())
+        {
+            trafficObject->startLiveTime();
+        }
+    }
+
+    if (m_publishStateWithoutPosition != Unchanged)
+    {
+        m_trafficObjectWithoutPosition->setAnimate(m_publishStateWithoutPosition == Updated);
+        m_trafficObjectWithoutPosition->copyFrom(*m_trafficTargetWithoutPosition);
+        if (m_trafficTargetWithoutPosition->valid())
+        {
+            m_trafficObjectWithoutPosition->startLiveTime();
+        }
+        m_publishStateWithoutPosition = Unchanged;
+    }
+}
+
+
 void Traffic::TrafficDataProvider::resetWarning()
 {
     setWarning( Traffic::Warning() );
@@ -407,6 +476,70 @@ void Traffic::TrafficDataProvider::setPassword(const QString& SSID, const QStrin
 }
 
 
+void Traffic::TrafficDataProvider::setNumTrafficObjects(int numTrafficObjects)
+{
+    if (numTrafficObjects == m_trafficObjects.size())
+    {
+        return;
+    }
+
+    // Remove surplus traffic objects. QML might still hold references, so
+    // delete them later.
+    while (m_trafficObjects.size() > numTrafficObjects)
+    {
+        m_trafficObjects.takeLast()->deleteLater();
+        auto* target = m_trafficTargets.takeLast();
+        target->disconnect(this);
+        delete target;
+    }
+
+    // Create additional traffic objects, together with the targets that
+    // collect the reports between two publications. When a target becomes
+    // invalid, its priority changes and the heap needs to be updated.
+    m_trafficObjects.reserve(numTrafficObjects);
+    m_trafficTargets.reserve(numTrafficObjects);
+    while (m_trafficObjects.size() < numTrafficObjects)
+    {
+        auto slot = m_trafficObjects.size();
+        auto *trafficObject = new Traffic::TrafficFactor_WithPosition(this);
+        QQmlEngine::setObjectOwnership(trafficObject, QQmlEngine::CppOwnership);
+        m_trafficObjects.append( trafficObject );
+        auto *target = new Traffic::TrafficFactor_WithPosition(this);
+        connect(target, &Traffic::TrafficFactor_Abstract::validChanged, this, [this, slot]() { updateSlotHeap(slot); });
+        m_trafficTargets.append( target );
+    }
+
+    // Surviving slots keep their publish states. New slots are published
+    // once, so that their traffic objects match their targets.
+    auto numPublishStates = m_publishStates.size();
+    m_publishStates.resize(m_trafficObjects.size());
+    for(auto slot = numPublishStates; slot < m_publishStates.size(); slot++)
+    {
+        m_publishStates[slot] = Unchanged;
+        markForPublishing(slot, Replaced);
+    }
+
+    // Rebuild index and heap
+    m_slotByID.clear();
+    m_slotHeap.clear();
+    m_heapPosition.clear();
+    for(qsizetype slot = 0; slot < m_trafficTargets.size(); slot++)
+    {
+        m_slotHeap.append(slot);
+        m_heapPosition.append(slot);
+        updateSlotHeap(slot);
+
+        auto ID = m_trafficTargets.at(slot)->ID();
+        if (!ID.isEmpty())
+        {
+            m_slotByID.insert(ID, slot);
+        }
+    }
+
+    emit trafficObjectsChanged();
+}
+
+
 void Traffic::TrafficDataProvider::setReceivingHeartbeat(bool newReceivingHeartbeat)
 {
     if (m_receivingHeartbeat == newReceivingHeartbeat)
@@ -435,6 +568,48 @@ void Traffic::TrafficDataProvider::setWarning(const Traffic::Warning& warning)
 }
 
 
+void Traffic::TrafficDataProvider::updateSlotHeap(qsizetype slot)
+{
+    auto swap = [this](qsizetype i, qsizetype j) {
+        std::swap(m_slotHeap[i], m_slotHeap[j]);
+        m_heapPosition[m_slotHeap[i]] = i;
+        m_heapPosition[m_slotHeap[j]] = j;
+    };
+
+    // Move up while the slot has lower priority than its parent
+    auto position = m_heapPosition.at(slot);
+    while (position > 0)
+    {
+        auto parent = (position-1)/2;
+        if (!hasLowerPriority(m_slotHeap.at(position), m_slotHeap.at(parent)))
+        {
+            break;
+        }
+        swap(position, parent);
+        position = parent;
+    }
+
+    // Move down while one of the children has lower priority than the slot
+    while (true)
+    {
+        auto lowest = position;
+        for(auto child : {2*position+1, 2*position+2})
+        {
+            if ((child < m_slotHeap.size()) && hasLowerPriority(m_slotHeap.at(child), m_slotHeap.at(lowest)))
+            {
+                lowest = child;
+            }
+        }
+        if (lowest == position)
+        {
+            break;
+        }
+        swap(position, lowest);
+        position = lowest;
+    }
+}
+
+
 void Traffic::TrafficDataProvider::updateStatusString()
 {
     if (receivingHeartbeat())
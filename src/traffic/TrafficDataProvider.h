@@ -118,9 +118,11 @@ public:
      *  QQmlListProperty for better cooperation with QML. Note that only the
      *  valid items in this list pertain to actual traffic. Invalid items should
      *  be ignored. The list is not sorted in any way. The items themselves are
-     *  owned by this class.
+     *  owned by this class. The length of the list is given by the setting
+     *  GlobalSettings::trafficTargets, and the list changes only when that
+     *  setting changes.
      */
-    Q_PROPERTY(QList<Traffic::TrafficFactor_WithPosition*> trafficObjects READ trafficObjects CONSTANT)
+    Q_PROPERTY(QList<Traffic::TrafficFactor_WithPosition*> trafficObjects READ trafficObjects NOTIFY trafficObjectsChanged)
 
     /*! \brief Getter method for property with the same name
      *
@@ -236,6 +238,9 @@ signals:
     /*! \brief Notifier signal */
     void receivingHeartbeatChanged(bool);
 
+    /*! \brief Notifier signal */
+    void trafficObjectsChanged();
+
     /*! \brief Notifier signal */
     void trafficReceiverRuntimeErrorChanged(QString message);
 
@@ -276,7 +281,7 @@ public slots:
 private slots:   
     // Intializations that are moved out of the constructor, in order to avoid
     // nested uses of constructors in Global.
-    void deferredInitialization() const;
+    void deferredInitialization();
 
     // Sends out foreflight broadcast message See
     // https://www.foreflight.com/connect/spec/
@@ -294,6 +299,10 @@ private slots:
     // Called if one of the sources reports or clears an error string
     void onTrafficReceiverSelfTestError(const QString& msg);
 
+    // Copies all targets that have changed since the last call to the
+    // traffic objects that are exposed to QML
+    void publishTrafficObjects();
+
     // Called if one of the sources reports or clears an error string
     void onTrafficReceiverRuntimeError(const QString& msg);
 
@@ -311,15 +320,67 @@ private slots:
     void updateStatusString();
 
 private:
+    // State of a slot, with respect to publishing. Ordered, so that qMax
+    // combines several changes between two publications.
+    enum PublishState : quint8
+    {
+        // The traffic object agrees with the target
+        Unchanged,
+
+        // The target has been updated with new data on the same aircraft
+        Updated,
+
+        // The target has been replaced by another aircraft, or cleared
+        Replaced
+    };
+
+    // Marks the slot for publication and starts m_publishTimer if necessary
+    void markForPublishing(qsizetype slot, PublishState state);
+
+    // Returns true if the traffic object in slot a has strictly lower priority
+    // than the one in slot b, in the sense of
+    // TrafficFactor_Abstract::hasHigherPriorityThan.
+    [[nodiscard]] auto hasLowerPriority(qsizetype slotA, qsizetype slotB) const -> bool;
+
+    // Resizes m_trafficObjects and m_trafficTargets and rebuilds m_slotByID and
+    // m_slotHeap. Emits
+    // trafficObjectsChanged() if the number changes.
+    void setNumTrafficObjects(int numTrafficObjects);
+
+    // Restores the heap property of m_slotHeap after the priority of the
+    // traffic object in the given slot has changed.
+    void updateSlotHeap(qsizetype slot);
+
     // UDP Socket for ForeFlight Broadcast messages.
     // See https://www.foreflight.com/connect/spec/
     QNetworkDatagram foreFlightBroadcastDatagram {R"({"App":"Enroute Flight Navigation","GDL90":{"port":4000}})", QHostAddress::Broadcast, 63093};
     QUdpSocket foreFlightBroadcastSocket;
     QTimer foreFlightBroadcastTimer;
 
-    // Targets
+    // Traffic objects exposed to QML, and the targets that collect incoming
+    // reports. Reports are never applied to the traffic objects directly.
+    // Instead, they update the targets, and changed targets are copied to the
+    // traffic objects at most once every publishInterval. This way, QML
+    // re-evaluates its bindings once per batch of reports rather than once
+    // per report. Both lists have the same length; the index in the lists is
+    // called the slot.
     QList<Traffic::TrafficFactor_WithPosition *> m_trafficObjects;
+    QList<Traffic::TrafficFactor_WithPosition *> m_trafficTargets;
+    QList<PublishState> m_publishStates;
+    QTimer m_publishTimer;
+    static constexpr auto publishInterval = 100ms;
+
+    // Index of the targets. The hash maps target IDs to slots. The list m_slotHeap is a binary heap of
+    // all slots, ordered by priority, with the slot of lowest priority at the
+    // front. The list m_heapPosition maps slots to their position in
+    // m_slotHeap. With these, finding the slot for an incoming report costs
+    // O(1), and replacing the slot of lowest priority costs O(log n).
+    QHash<QString, qsizetype> m_slotByID;
+    QList<qsizetype> m_slotHeap;
+    QList<qsizetype> m_heapPosition;
     QPointer<Traffic::TrafficFactor_DistanceOnly> m_trafficObjectWithoutPosition;
+    QPointer<Traffic::TrafficFactor_DistanceOnly> m_trafficTargetWithoutPosition;
+    PublishState m_publishStateWithoutPosition {Unchanged};
 
     // TrafficData Sources
     QList<QPointer<Traffic::TrafficDataSource_Abstract>> m_dataSources;
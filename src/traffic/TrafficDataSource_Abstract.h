@@ -306,24 +306,31 @@ protected:
      *
      *  This method expects exactly one line containing a valid FLARM/NMEA
      *  sentence. This is a string typically looks like
-     *  "$PFLAA,0,1587,1588,40,1,AA1237,225,,37,-1.6,1*7F".  The method
-     *  interprets the string and updates the properties and emits signals as
-     *  appropriate. Invalid strings are silently ignored.
+     *  "$PFLAA,0,1587,1588,40,1,AA1237,225,,37,-1.6,1*7F".  Trailing line
+     *  breaks are ignored.  The method interprets the string and updates the
+     *  properties and emits signals as appropriate. Invalid strings are
+     *  silently ignored.
+     *
+     *  The sentence is parsed in place, without copying data, so that the
+     *  method can be called directly on the receive buffer of a socket.
      *
-     *  @param sentence A QString containing a FLARM/NMEA sentence.
+     *  @param sentence A byte array view containing a FLARM/NMEA sentence.
      */
-    void processFLARMSentence(QString sentence);
+    void processFLARMSentence(QByteArrayView sentence);
 
     /*! \brief Process one GDL90 message
      *
-     *  This method expects exactly one GDL90 message, including starting and
-     *  trailing 0x7e bytes.  The method interprets the string and updates the
-     *  properties and emits signals as appropriate. Invalid messages are
-     *  silently ignored.
+     *  This method expects exactly one GDL90 message, without the starting
+     *  and trailing 0x7e flag bytes.  The method interprets the string and
+     *  updates the properties and emits signals as appropriate. Invalid
+     *  messages are silently ignored.
+     *
+     *  The message is decoded in place, so that the method can be called
+     *  directly on the receive buffer of a socket.
      *
-     *  @param message A QByteArray containing a GDL90 message.
+     *  @param message A byte array view containing a GDL90 message.
      */
-    void processGDLMessage(const QByteArray& message);
+    void processGDLMessage(QByteArrayView message);
 
     /*! \brief Process one XGPS string
      *
@@ -18,6 +18,8 @@
  *   59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.             *
  ***************************************************************************/
 
+#include <array>
+
 #include "GlobalObject.h"
 #include "platform/PlatformAdaptor_Abstract.h"
 #include "positioning/PositionProvider.h"
@@ -27,29 +29,106 @@
 
 // Static Helper functions
 
-auto interpretNMEALatLong(const QString& A, const QString& B) -> qreal
+namespace {
+
+// Value of hexadecimal digits, or -1 for characters that are not hexadecimal
+// digits. Used to decode the NMEA checksum.
+constexpr auto hexDigitTable = []() {
+    std::array<qint8, 256> table {};
+    table.fill(-1);
+    for (int i = 0; i < 10; i++) {
+        table['0'+i] = static_cast<qint8>(i);
+    }
+    for (int i = 0; i < 6; i++) {
+        table['A'+i] = static_cast<qint8>(10+i);
+        table['a'+i] = static_cast<qint8>(10+i);
+    }
+    return table;
+}();
+
+// Message types, such as "PFLAA", packed into an integer that can be used in
+// switch statements. Types longer than eight characters are mapped to zero.
+constexpr auto messageTag(QByteArrayView type) -> quint64
+{
+    if (type.size() > 8) {
+        return 0;
+    }
+    quint64 result = 0;
+    for (qsizetype i = 0; i < type.size(); i++) {
+        result = (result << 8) | static_cast<quint8>(type[i]);
+    }
+    return result;
+}
+
+// Comma-separated fields of an NMEA sentence. The fields are views into the
+// sentence, so the sentence must outlive this object. Fields beyond the end
+// of the sentence are empty, so that optional trailing fields need not be
+// checked individually.
+class NMEAFields
+{
+public:
+    NMEAFields() = default;
+
+    explicit NMEAFields(QByteArrayView payload)
+    {
+        qsizetype fieldStart = 0;
+        for (qsizetype i = 0; i <= payload.size(); i++) {
+            if ((i < payload.size()) && (payload[i] != ',')) {
+                continue;
+            }
+            if (m_length == maxFields) {
+                break;
+            }
+            m_fields[m_length++] = payload.sliced(fieldStart, i-fieldStart);
+            fieldStart = i+1;
+        }
+    }
+
+    [[nodiscard]] auto length() const -> qsizetype { return m_length; }
+
+    auto operator[](qsizetype index) const -> QByteArrayView
+    {
+        return (index < m_length) ? m_fields[index] : QByteArrayView();
+    }
+
+private:
+    // FLARM sentences have at most 20 fields
+    static constexpr qsizetype maxFields = 32;
+
+    std::array<QByteArrayView, maxFields> m_fields {};
+    qsizetype m_length {0};
+};
+
+// Latitude or longitude, given as "ddmm.mmm" or "dddmm.mmm", with hemisphere
+// "N", "S", "E" or "W"
+auto interpretNMEALatLong(QByteArrayView value, QByteArrayView hemisphere, qsizetype degreeDigits) -> qreal
 {
+    if (value.size() <= degreeDigits) {
+        return qQNaN();
+    }
+
     bool ok1 = false;
     bool ok2 = false;
-    qreal result = A.left(2).toDouble(&ok1) + A.mid(2).toDouble(&ok2)/60.0;
+    qreal result = value.first(degreeDigits).toDouble(&ok1) + value.sliced(degreeDigits).toDouble(&ok2)/60.0;
     if (!ok1 || !ok2) {
         return qQNaN();
     }
 
-    if ((B == u"S") || (B == u"W")) {
+    if ((hemisphere == "S") || (hemisphere == "W")) {
         result *= -1.0;
     }
     return result;
 }
 
-auto interpretNMEATime(const QString& timeString) -> QDateTime
+// Time, given as "hhmmss" or "hhmmss.ss"
+auto interpretNMEATime(QByteArrayView timeString) -> QDateTime
 {
-    auto HH = timeString.mid(0,2);
-    auto MM = timeString.mid(2,2);
-    auto SS = timeString.mid(4,2);
-    auto MS = timeString.mid(6);
-    QTime time(HH.toInt(), MM.toInt(), SS.toInt());
-    if (MS.isEmpty()) {
+    if (timeString.size() < 6) {
+        return {};
+    }
+    QTime time(timeString.sliced(0,2).toInt(), timeString.sliced(2,2).toInt(), timeString.sliced(4,2).toInt());
+    auto MS = timeString.sliced(6);
+    if (!MS.isEmpty()) {
         time = time.addMSecs(qRound(MS.toDouble()*1000.0));
     }
     auto dateTime = QDateTime::currentDateTimeUtc();
@@ -57,54 +136,75 @@ auto interpretNMEATime(const QString& timeString) -> QDateTime
     return dateTime;
 }
 
+} // namespace
+
 
 // Member functions
 
-void Traffic::TrafficDataSource_Abstract::processFLARMSentence(QString sentence)
+void Traffic::TrafficDataSource_Abstract::processFLARMSentence(QByteArrayView sentence)
 {
-    if (sentence.isEmpty()) {
-        return;
+    // Remove trailing line breaks and white space
+    while (!sentence.isEmpty() && (static_cast<quint8>(sentence.back()) <= ' ')) {
+        sentence.chop(1);
     }
 
     // Check that line starts with a dollar sign
     if (sentence.isEmpty()) {
         return;
     }
-    if (sentence[0] != QStringLiteral("$")) {
+    if (sentence[0] != '$') {
         return;
     }
-    sentence = sentence.mid(1);
+    sentence = sentence.sliced(1);
 
-    // Check the NMEA checksum
-    auto pieces = sentence.split(QStringLiteral("*"));
-    if (pieces.length() != 2) {
+    // Check the NMEA checksum. The payload is everything between the dollar
+    // sign and the asterisk; the checksum is the XOR of all payload bytes,
+    // given in hex after the asterisk.
+    quint8 myChecksum = 0;
+    qsizetype payloadLength = 0;
+    for(; payloadLength < sentence.size(); payloadLength++) {
+        if (sentence[payloadLength] == '*') {
+            break;
+        }
+        myChecksum ^= static_cast<quint8>(sentence[payloadLength]);
+    }
+    auto checksumString = sentence.sliced(qMin(payloadLength+1, sentence.size()));
+    if (checksumString.isEmpty() || (checksumString.size() > 2)) {
         return;
     }
-    sentence = pieces[0];
-    auto checksum = pieces[1].toInt(nullptr, 16);
-    quint8 myChecksum = 0;
-    for(auto && i : sentence) {
-        myChecksum ^= static_cast<quint8>(i.toLatin1());
+    int checksum = 0;
+    for(auto character : checksumString) {
+        auto digit = hexDigitTable[static_cast<quint8>(character)];
+        if (digit < 0) {
+            return;
+        }
+        checksum = 16*checksum + digit;
     }
     if (checksum != myChecksum) {
         return;
     }
 
-    // Split the message into pieces
-    auto arguments = sentence.split(QStringLiteral(","));
-    if (arguments.isEmpty()) {
-        return;
+    // Split the message into message type and arguments
+    auto payload = sentence.first(payloadLength);
+    auto messageType = payload;
+    NMEAFields arguments;
+    for(qsizetype i = 0; i < payload.size(); i++) {
+        if (payload[i] == ',') {
+            messageType = payload.first(i);
+            arguments = NMEAFields(payload.sliced(i+1));
+            break;
+        }
     }
-    auto messageType = arguments.takeFirst();
 
+    switch(messageTag(messageType)) {
     // NMEA GPS 3D-fix data
-    if (messageType == u"GPGGA") {
+    case messageTag("GPGGA"): {
         if (arguments.length() < 9) {
             return;
         }
 
         // Quality check
-        if (arguments[5] == u"0") {
+        if (arguments[5] == "0") {
             return;
         }
 
@@ -131,13 +231,13 @@ void Traffic::TrafficDataSource_Abstract::processFLARMSentence(QString sentence)
     }
 
     // Recommended minimum specific GPS/Transit data
-    if (messageType == u"GPRMC") {
+    case messageTag("GPRMC"): {
         if (arguments.length() < 8) {
             return;
         }
 
         // Quality check
-        if (arguments[1] != u"A") {
+        if (arguments[1] != "A") {
             return;
         }
 
@@ -148,23 +248,11 @@ void Traffic::TrafficDataSource_Abstract::processFLARMSentence(QString sentence)
         }
 
         // Get coordinate
-        bool ok1 = false;
-        bool ok2 = false;
-        auto lat = arguments[2].left(2).toDouble(&ok1) + arguments[2].mid(2).toDouble(&ok2)/60.0;
-        if (!ok1 || !ok2) {
+        auto lat = interpretNMEALatLong(arguments[2], arguments[3], 2);
+        auto lon = interpretNMEALatLong(arguments[4], arguments[5], 3);
+        if (!qIsFinite(lat) || !qIsFinite(lon)) {
             return;
         }
-        if (arguments[3] == u"S") {
-            lat *= -1.0;
-        }
-
-        auto lon = arguments[4].left(3).toDouble(&ok1) + arguments[4].mid(3).toDouble(&ok2)/60.0;
-        if (!ok1 || !ok2) {
-            return;
-        }
-        if (arguments[5] == u"W") {
-            lon *= -1.0;
-        }
 
         QGeoCoordinate coordinate(lat, lon);
         if (!coordinate.isValid()) {
@@ -187,10 +275,7 @@ void Traffic::TrafficDataSource_Abstract::processFLARMSentence(QString sentence)
 
         // Track
         auto TT = arguments[7].toDouble(&ok);
-        if (!ok) {
-            TT = qQNaN();
-        }
-        if (TT != qQNaN()) {
+        if (ok) {
             pInfo.setAttribute(QGeoPositionInfo::Direction, TT );
         }
 
@@ -199,7 +284,7 @@ void Traffic::TrafficDataSource_Abstract::processFLARMSentence(QString sentence)
     }
 
     // Data on other proximate aircraft
-    if (messageType == u"PFLAA") {
+    case messageTag("PFLAA"): {
 
         // Helper variable
         bool ok = false;
@@ -228,44 +313,48 @@ void Traffic::TrafficDataSource_Abstract::processFLARMSentence(QString sentence)
         Traffic::TrafficFactor_Abstract::AircraftType type = Traffic::TrafficFactor_Abstract::unknown;
         {
             auto targetType = arguments[10];
-            if (targetType == u"1") {
-                type = Traffic::TrafficFactor_Abstract::Glider;
-            }
-            if (targetType == u"2") {
-                type = Traffic::TrafficFactor_Abstract::TowPlane;
-            }
-            if (targetType == u"3") {
-                type = Traffic::TrafficFactor_Abstract::Copter;
-            }
-            if (targetType == u"4") {
-                type = Traffic::TrafficFactor_Abstract::Skydiver;
-            }
-            if (targetType == u"5") {
-                type = Traffic::TrafficFactor_Abstract::Aircraft;
-            }
-            if (targetType == u"6") {
-                type = Traffic::TrafficFactor_Abstract::HangGlider;
-            }
-            if (targetType == u"7") {
-                type = Traffic::TrafficFactor_Abstract::Paraglider;
-            }
-            if (targetType == u"8") {
-                type = Traffic::TrafficFactor_Abstract::Aircraft;
-            }
-            if (targetType == u"9") {
-                type = Traffic::TrafficFactor_Abstract::Jet;
-            }
-            if (targetType == u"B") {
-                type = Traffic::TrafficFactor_Abstract::Balloon;
-            }
-            if (targetType == u"C") {
-                type = Traffic::TrafficFactor_Abstract::Airship;
-            }
-            if (targetType == u"D") {
-                type = Traffic::TrafficFactor_Abstract::Drone;
-            }
-            if (targetType == u"F") {
-                type = Traffic::TrafficFactor_Abstract::StaticObstacle;
+            if (targetType.size() == 1) {
+                switch(targetType[0]) {
+                case '1':
+                    type = Traffic::TrafficFactor_Abstract::Glider;
+                    break;
+                case '2':
+                    type = Traffic::TrafficFactor_Abstract::TowPlane;
+                    break;
+                case '3':
+                    type = Traffic::TrafficFactor_Abstract::Copter;
+                    break;
+                case '4':
+                    type = Traffic::TrafficFactor_Abstract::Skydiver;
+                    break;
+                case '5':
+                case '8':
+                    type = Traffic::TrafficFactor_Abstract::Aircraft;
+                    break;
+                case '6':
+                    type = Traffic::TrafficFactor_Abstract::HangGlider;
+                    break;
+                case '7':
+                    type = Traffic::TrafficFactor_Abstract::Paraglider;
+                    break;
+                case '9':
+                    type = Traffic::TrafficFactor_Abstract::Jet;
+                    break;
+                case 'B':
+                    type = Traffic::TrafficFactor_Abstract::Balloon;
+                    break;
+                case 'C':
+                    type = Traffic::TrafficFactor_Abstract::Airship;
+                    break;
+                case 'D':
+                    type = Traffic::TrafficFactor_Abstract::Drone;
+                    break;
+                case 'F':
+                    type = Traffic::TrafficFactor_Abstract::StaticObstacle;
+                    break;
+                default:
+                    break;
+                }
             }
         }
 
@@ -281,13 +370,13 @@ void Traffic::TrafficDataSource_Abstract::processFLARMSentence(QString sentence)
 
 
         // Target ID is optional
-        auto targetID = arguments[5];
+        auto targetID = QString::fromLatin1(arguments[5]);
 
 
         //
         // Handle non-directional targets
         //
-        if (arguments[2] == u"") {
+        if (arguments[2].isEmpty()) {
             // Horizontal distance is mandatory
             auto hDist = Units::Distance::fromM(arguments[1].toDouble(&ok));
             if (!ok) {
@@ -370,7 +459,7 @@ void Traffic::TrafficDataSource_Abstract::processFLARMSentence(QString sentence)
     }
 
     // Self-test result and errors codes
-    if (messageType == u"PFLAE") {
+    case messageTag("PFLAE"): {
         if (arguments.length() < 3) {
             return;
         }
@@ -379,155 +468,155 @@ void Traffic::TrafficDataSource_Abstract::processFLARMSentence(QString sentence)
         auto errorCode = arguments[2];
 
         QStringList results;
-        if (severity == u"0") {
+        if (severity == "0") {
             results << tr("No Error");
         }
-        if (severity == u"1") {
+        if (severity == "1") {
             results << tr("Normal Operation");
         }
-        if (severity == u"2") {
+        if (severity == "2") {
             results << tr("Reduced Functionality");
         }
-        if (severity == u"3") {
+        if (severity == "3") {
             results << tr("Device INOP");
         }
 
         if (!errorCode.isEmpty()) {
-            results << tr("Error code: %1").arg(errorCode);
+            results << tr("Error code: %1").arg(QString::fromLatin1(errorCode));
         }
-        if (errorCode == u"11") {
+        if (errorCode == "11") {
             results << tr("Firmware expired");
         }
-        if (errorCode == u"12") {
+        if (errorCode == "12") {
             results << tr("Firmware update error");
         }
-        if (errorCode == u"21") {
+        if (errorCode == "21") {
             results << tr("Power (Voltage < 8V)");
         }
-        if (errorCode == u"22") {
+        if (errorCode == "22") {
             results << tr("UI error");
         }
-        if (errorCode == u"23") {
+        if (errorCode == "23") {
             results << tr("Audio error");
         }
-        if (errorCode == u"24") {
+        if (errorCode == "24") {
             results << tr("ADC error");
         }
-        if (errorCode == u"25") {
+        if (errorCode == "25") {
             results << tr("SD card error");
         }
-        if (errorCode == u"26") {
+        if (errorCode == "26") {
             results << tr("USB error");
         }
-        if (errorCode == u"27") {
+        if (errorCode == "27") {
             results << tr("LED error");
         }
-        if (errorCode == u"28") {
+        if (errorCode == "28") {
             results << tr("EEPROM error");
         }
-        if (errorCode == u"29") {
+        if (errorCode == "29") {
             results << tr("General hardware error");
         }
-        if (errorCode == u"2A") {
+        if (errorCode == "2A") {
             results << tr("Transponder receiver Mode-C/S/ADS-B unserviceable");
         }
-        if (errorCode == u"2B") {
+        if (errorCode == "2B") {
             results << tr("EEPROM error");
         }
-        if (errorCode == u"2C") {
+        if (errorCode == "2C") {
             results << tr("GPIO error");
         }
-        if (errorCode == u"31") {
+        if (errorCode == "31") {
             results << tr("GPS communication");
         }
-        if (errorCode == u"32") {
+        if (errorCode == "32") {
             results << tr("Configuration of GPS module");
         }
-        if (errorCode == u"33") {
+        if (errorCode == "33") {
             results << tr("GPS antenna");
         }
-        if (errorCode == u"41") {
+        if (errorCode == "41") {
             results << tr("RF communication");
         }
-        if (errorCode == u"42") {
+        if (errorCode == "42") {
             results << tr("Another FLARM device with the same Radio ID is being received. Alarms are suppressed for the relevant device.");
         }
-        if (errorCode == u"43") {
+        if (errorCode == "43") {
             results << tr("Wrong ICAO 24-bit address or radio ID");
         }
-        if (errorCode == u"51") {
+        if (errorCode == "51") {
             results << tr("Communication");
         }
-        if (errorCode == u"61") {
+        if (errorCode == "61") {
             results << tr("Flash memory");
         }
-        if (errorCode == u"71") {
+        if (errorCode == "71") {
             results << tr("Pressure sensor");
         }
-        if (errorCode == u"81") {
+        if (errorCode == "81") {
             results << tr("Obstacle database (e.g. incorrect file type)");
         }
-        if (errorCode == u"82") {
+        if (errorCode == "82") {
             results << tr("Obstacle database expired.");
         }
-        if (errorCode == u"91") {
+        if (errorCode == "91") {
             results << tr("Flight recorder");
         }
-        if (errorCode == u"93") {
+        if (errorCode == "93") {
             results << tr("Engine-noise recording not possible");
         }
-        if (errorCode == u"94") {
+        if (errorCode == "94") {
             results << tr("Range analyzer");
         }
-        if (errorCode == u"A1") {
+        if (errorCode == "A1") {
             results << tr("Configuration error, e.g. while reading flarmcfg.txt from SD/USB.");
         }
-        if (errorCode == u"B1") {
+        if (errorCode == "B1") {
             results << tr("Invalid obstacle database license (e.g. wrong serial number)");
         }
-        if (errorCode == u"B2") {
+        if (errorCode == "B2") {
             results << tr("Invalid IGC feature license");
         }
-        if (errorCode == u"B3") {
+        if (errorCode == "B3") {
             results << tr("Invalid AUD feature license");
         }
-        if (errorCode == u"B4") {
+        if (errorCode == "B4") {
             results << tr("Invalid ENL feature license");
         }
-        if (errorCode == u"B5") {
+        if (errorCode == "B5") {
             results << tr("Invalid RFB feature license");
         }
-        if (errorCode == u"B6") {
+        if (errorCode == "B6") {
             results << tr("Invalid TIS feature license");
         }
-        if (errorCode == u"100") {
+        if (errorCode == "100") {
             results << tr("Generic error");
         }
-        if (errorCode == u"101") {
+        if (errorCode == "101") {
             results << tr("Flash File System error");
         }
-        if (errorCode == u"110") {
+        if (errorCode == "110") {
             results << tr("Failure updating firmware of external display");
         }
-        if (errorCode == u"120") {
+        if (errorCode == "120") {
             results << tr("Device is operated outside the designated region. The device does not work.");
         }
         auto result = results.join(QStringLiteral(" • "));
 
         // Emit results of self-test
-        if ((severity == u"2") || (severity == u"3")) {
+        if ((severity == "2") || (severity == "3")) {
             setTrafficReceiverSelfTestError(result);
         }
         return;
     }
 
     // Debug Information -- Ignore
-    if (messageType == u"PFLAS") {
+    case messageTag("PFLAS"): {
         return;
     }
 
     // FLARM Heartbeat
-    if (messageType == u"PFLAU") {
+    case messageTag("PFLAU"): {
         // Heartbeat received.
         setReceivingHeartbeat(true);
 
@@ -539,15 +628,15 @@ void Traffic::TrafficDataSource_Abstract::processFLARMSentence(QString sentence)
         QStringList results;
         // auto RX = arguments[0];
         auto TX = arguments[1];
-        if (TX == u"0"_qs) {
+        if (TX == "0") {
             results += tr("No FLARM transmission");
         }
         auto GPS = arguments[2];
-        if (GPS == u"0"_qs) {
+        if (GPS == "0") {
             results += tr("No GPS reception");
         }
         auto Power = arguments[3];
-        if (Power == u"0"_qs) {
+        if (Power == "0") {
             results += tr("Under- or Overvoltage");
         }
         setTrafficReceiverRuntimeError(results.join(QStringLiteral(" • ")));
@@ -558,34 +647,38 @@ void Traffic::TrafficDataSource_Abstract::processFLARMSentence(QString sentence)
         auto RelativeVertical = arguments[7];
         auto RelativeDistance = arguments[8];
 
-        auto wrning = Traffic::Warning(AlarmLevel, RelativeBearing, AlarmType, RelativeVertical, RelativeDistance);
+        auto wrning = Traffic::Warning(QString::fromLatin1(AlarmLevel),
+                                       QString::fromLatin1(RelativeBearing),
+                                       QString::fromLatin1(AlarmType),
+                                       QString::fromLatin1(RelativeVertical),
+                                       QString::fromLatin1(RelativeDistance));
         emit warning(wrning);
 
         return;
     }
 
     // Version information
-    if (messageType == u"PFLAV") {
+    case messageTag("PFLAV"): {
         if (arguments.length() < 4) {
             return;
         }
 
-        emit trafficReceiverHwVersion(arguments[1]);
-        emit trafficReceiverSwVersion(arguments[2]);
-        emit trafficReceiverObVersion(arguments[3]);
+        emit trafficReceiverHwVersion(QString::fromLatin1(arguments[1]));
+        emit trafficReceiverSwVersion(QString::fromLatin1(arguments[2]));
+        emit trafficReceiverObVersion(QString::fromLatin1(arguments[3]));
 
 
         return;
     }
 
     // Garmin's barometric altitude
-    if (messageType == u"PGRMZ") {
+    case messageTag("PGRMZ"): {
         if (arguments.length() < 2) {
             return;
         }
 
         // Quality check
-        if (arguments[1] != u"F") {
+        if (arguments[1] != "F") {
             return;
         }
 
@@ -601,4 +694,8 @@ void Traffic::TrafficDataSource_Abstract::processFLARMSentence(QString sentence)
         emit pressureAltitudeUpdated(barometricAlt);
         return;
     }
+
+    default:
+        return;
+    }
 }
@@ -25,182 +25,246 @@
 #include "positioning/PositionProvider.h"
 #include "traffic/TrafficDataSource_Abstract.h"
 
-const std::array<quint16, 256> Crc16Table =
-{ 0, 4129, 8258, 12387, 16516, 20645, 24774, 28903, 33032, 37161,
-  41290, 45419, 49548, 53677, 57806, 61935, 4657, 528, 12915,
-  8786, 21173, 17044, 29431, 25302, 37689, 33560, 45947, 41818,
-  54205, 50076, 62463, 58334, 9314, 13379, 1056, 5121, 25830,
-  29895, 17572, 21637, 42346, 46411, 34088, 38153, 58862, 62927,
-  50604, 54669, 13907, 9842, 5649, 1584, 30423, 26358, 22165,
-  18100, 46939, 42874, 38681, 34616, 63455, 59390, 55197, 51132,
-  18628, 22757, 26758, 30887, 2112, 6241, 10242, 14371, 51660,
-  55789, 59790, 63919, 35144, 39273, 43274, 47403, 23285, 19156,
-  31415, 27286, 6769, 2640, 14899, 10770, 56317, 52188, 64447,
-  60318, 39801, 35672, 47931, 43802, 27814, 31879, 19684, 23749,
-  11298, 15363, 3168, 7233, 60846, 64911, 52716, 56781, 44330,
-  48395, 36200, 40265, 32407, 28342, 24277, 20212, 15891, 11826,
-  7761, 3696, 65439, 61374, 57309, 53244, 48923, 44858, 40793,
-  36728, 37256, 33193, 45514, 41451, 53516, 49453, 61774, 57711,
-  4224, 161, 12482, 8419, 20484, 16421, 28742, 24679, 33721,
-  37784, 41979, 46042, 49981, 54044, 58239, 62302, 689, 4752,
-  8947, 13010, 16949, 21012, 25207, 29270, 46570, 42443, 38312,
-  34185, 62830, 58703, 54572, 50445, 13538, 9411, 5280, 1153,
-  29798, 25671, 21540, 17413, 42971, 47098, 34713, 38840, 59231,
-  63358, 50973, 55100, 9939, 14066, 1681, 5808, 26199, 30326,
-  17941, 22068, 55628, 51565, 63758, 59695, 39368, 35305, 47498,
-  43435, 22596, 18533, 30726, 26663, 6336, 2273, 14466, 10403,
-  52093, 56156, 60223, 64286, 35833, 39896, 43963, 48026, 19061,
-  23124, 27191, 31254, 2801, 6864, 10931, 14994, 64814, 60687,
-  56684, 52557, 48554, 44427, 40424, 36297, 31782, 27655, 23652,
-  19525, 15522, 11395, 7392, 3265, 61215, 65342, 53085, 57212,
-  44955, 49082, 36825, 40952, 28183, 32310, 20053, 24180, 11923,
-  16050, 3793, 7920 };
-
-
-// Static Helper functions
-
-auto pInfoFromOwnshipReport(const QByteArray &decodedData) -> QGeoPositionInfo
+#include <cstring>
+
+namespace {
+
+// Maximal size of a GDL90 message, including escape characters. The largest
+// messages specified are uplink data messages with 436 bytes payload; in the
+// worst case, escaping doubles their size.
+constexpr qsizetype maxGDLMessageSize = 1024;
+
+// CRC-16-CCITT tables for the GDL90 checksum, as described in Section 2.2.3
+// of the GDL90 specification. The entry crcTables[k][v] is the remainder of
+// v*x^(8*(k+2)) modulo the polynomial x^16+x^12+x^5+1. The first table is the
+// table of the specification; the others allow processing eight bytes per
+// step ("slice-by-8").
+constexpr auto crcTables = []() {
+    std::array<std::array<quint16, 256>, 8> tables {};
+    for (unsigned int v = 0; v < 256; v++) {
+        quint16 crc = v;
+        for (int bit = 0; bit < 16; bit++) {
+            crc = static_cast<quint16>((crc << 1U) ^ (((crc & 0x8000U) != 0) ? 0x1021U : 0U));
+        }
+        tables[0][v] = crc;
+    }
+    for (size_t k = 1; k < tables.size(); k++) {
+        for (unsigned int v = 0; v < 256; v++) {
+            auto crc = tables[k-1][v];
+            tables[k][v] = static_cast<quint16>(tables[0][crc >> 8U] ^ (crc << 8U));
+        }
+    }
+    return tables;
+}();
+
+// GDL90 checksum of the data
+auto crc16(const quint8* data, qsizetype size) -> quint16
+{
+    quint16 crc = 0;
+    for(; size >= 8; data += 8, size -= 8) {
+        crc = static_cast<quint16>(crcTables[7][crc >> 8U] ^ crcTables[6][crc & 0xFFU]
+                                   ^ crcTables[5][data[0]] ^ crcTables[4][data[1]]
+                                   ^ crcTables[3][data[2]] ^ crcTables[2][data[3]]
+                                   ^ crcTables[1][data[4]] ^ crcTables[0][data[5]]
+                                   ^ (data[6] << 8U) ^ data[7]);
+    }
+    for(; size > 0; data++, size--) {
+        crc = static_cast<quint16>(crcTables[0][crc >> 8U] ^ (crc << 8U) ^ *data);
+    }
+    return crc;
+}
+
+// Content of an ownship report or traffic report. The two messages share the
+// same layout, see Section 3.5.1 of the GDL90 specification. Values that are
+// not available are NaN.
+struct GDL90Report
+{
+    quint8 alertStatus {0};
+    quint8 addressType {0};
+    quint32 address {0};
+    double latitude {qQNaN()};
+    double longitude {qQNaN()};
+    Units::Distance pressureAltitude;
+    double horizontalAccuracyInM {qQNaN()};
+    Units::Speed groundSpeed;
+    Units::Speed verticalSpeed;
+    double track {qQNaN()};
+    quint8 emitterCategory {0};
+    QByteArrayView callSign;
+};
+
+// Decodes the payload of an ownship report or traffic report, without the
+// message ID. Returns false if the payload has the wrong size.
+auto decodeReport(const quint8* data, qsizetype size, GDL90Report& report) -> bool
 {
     // Check message size
-    if (decodedData.length() != 27) {
-        return {};
+    if (size != 27) {
+        return false;
     }
 
-    // Find latitude
-    auto la0 = static_cast<quint8>(decodedData.at(4));
-    auto la1 = static_cast<quint8>(decodedData.at(5));
-    auto la2 = static_cast<quint8>(decodedData.at(6));
-    qint32 laInt = (la0 << 16) + (la1 << 8) + la2;
+    // Alert status and participant address
+    report.alertStatus = data[0] >> 4U;
+    report.addressType = data[0] & 0x0FU;
+    report.address = ((data[1] << 16U) | (data[2] << 8U) | data[3]);
+
+    // Latitude and longitude, 24-bit signed binary fractions
+    auto laInt = static_cast<qint32>((data[4] << 16U) | (data[5] << 8U) | data[6]);
     if (laInt > 8388607) {
         laInt -= 16777216;
     }
-    double lat = (180.0/0x800000)*laInt;
-
-    // Find longitude
-    auto ln0 = static_cast<quint8>(decodedData.at(7));
-    auto ln1 = static_cast<quint8>(decodedData.at(8));
-    auto ln2 = static_cast<quint8>(decodedData.at(9));
-    qint32 lnInt = (ln0 << 16) + (ln1 << 8) + ln2;
+    report.latitude = (180.0/0x800000)*laInt;
+    auto lnInt = static_cast<qint32>((data[7] << 16U) | (data[8] << 8U) | data[9]);
     if (lnInt > 8388607) {
         lnInt -= 16777216;
     }
-    double lon = (180.0/0x800000)*lnInt;
+    report.longitude = (180.0/0x800000)*lnInt;
 
-    // Construct coordinate, generate position info
-    QGeoCoordinate coordinate(lat, lon);
-    if (!coordinate.isValid()) {
-        return {};
+    // Pressure altitude
+    quint32 ddTmp = (data[10] << 4U) + (data[11] >> 4U);
+    if (ddTmp != 0xFFF) {
+        report.pressureAltitude = Units::Distance::fromFT(25.0*ddTmp - 1000.0);
     }
-    QGeoPositionInfo pInfo(coordinate, QDateTime::currentDateTimeUtc());
 
-    // Find Navigation Accuracy Category for Position
-    auto a = static_cast<quint8>(decodedData.at(12)) & 0x0FU;
-    switch (a) {
+    // Navigation Accuracy Category for Position
+    switch (data[12] & 0x0FU) {
     case 1:
-        pInfo.setAttribute(QGeoPositionInfo::HorizontalAccuracy, Units::Distance::fromNM(10.0).toM() );
+        report.horizontalAccuracyInM = Units::Distance::fromNM(10.0).toM();
         break;
     case 2:
-        pInfo.setAttribute(QGeoPositionInfo::HorizontalAccuracy, Units::Distance::fromNM(4.0).toM() );
+        report.horizontalAccuracyInM = Units::Distance::fromNM(4.0).toM();
         break;
     case 3:
-        pInfo.setAttribute(QGeoPositionInfo::HorizontalAccuracy, Units::Distance::fromNM(2.0).toM() );
+        report.horizontalAccuracyInM = Units::Distance::fromNM(2.0).toM();
         break;
     case 4:
-        pInfo.setAttribute(QGeoPositionInfo::HorizontalAccuracy, Units::Distance::fromNM(1.0).toM() );
+        report.horizontalAccuracyInM = Units::Distance::fromNM(1.0).toM();
         break;
     case 5:
-        pInfo.setAttribute(QGeoPositionInfo::HorizontalAccuracy, Units::Distance::fromNM(0.5).toM() );
+        report.horizontalAccuracyInM = Units::Distance::fromNM(0.5).toM();
         break;
     case 6:
-        pInfo.setAttribute(QGeoPositionInfo::HorizontalAccuracy, Units::Distance::fromNM(0.3).toM() );
+        report.horizontalAccuracyInM = Units::Distance::fromNM(0.3).toM();
         break;
     case 7:
-        pInfo.setAttribute(QGeoPositionInfo::HorizontalAccuracy, Units::Distance::fromNM(0.1).toM() );
+        report.horizontalAccuracyInM = Units::Distance::fromNM(0.1).toM();
         break;
     case 8:
-        pInfo.setAttribute(QGeoPositionInfo::HorizontalAccuracy, Units::Distance::fromNM(0.05).toM() );
+        report.horizontalAccuracyInM = Units::Distance::fromNM(0.05).toM();
         break;
     case 9:
-        pInfo.setAttribute(QGeoPositionInfo::HorizontalAccuracy, 30.0 );
+        report.horizontalAccuracyInM = 30.0;
         break;
     case 10:
-        pInfo.setAttribute(QGeoPositionInfo::HorizontalAccuracy, 10.0 );
+        report.horizontalAccuracyInM = 10.0;
         break;
     case 11:
-        pInfo.setAttribute(QGeoPositionInfo::HorizontalAccuracy, 3.0 );
+        report.horizontalAccuracyInM = 3.0;
         break;
     default:
         break;
     }
 
-    // Find horizontal speed if available
-    auto hh0 = static_cast<quint8>(decodedData.at(13));
-    auto hh1 = static_cast<quint8>(decodedData.at(14));
-    quint32 hhTmp = (hh0 << 4) + (hh1 >> 4);
+    // Horizontal speed
+    quint32 hhTmp = (data[13] << 4U) + (data[14] >> 4U);
     if (hhTmp != 0xFFF) {
-        Units::Speed hSpeed = Units::Speed::fromKN(hhTmp);
-        pInfo.setAttribute(QGeoPositionInfo::GroundSpeed, hSpeed.toMPS() );
+        report.groundSpeed = Units::Speed::fromKN(hhTmp);
     }
 
-    // Find vertical speed if available
-    auto vv0 = static_cast<quint8>(decodedData.at(14)) & 0x0FU;
-    auto vv1 = static_cast<quint8>(decodedData.at(15));
-    qint32 vvTmp = (vv0 << 8) + vv1;
+    // Vertical speed
+    qint32 vvTmp = ((data[14] & 0x0FU) << 8U) + data[15];
     if (vvTmp != 0x800) {
-        Units::Speed vSpeed;
         if (vvTmp < 0x800) {
-            vSpeed = Units::Speed::fromFPM(64.0*vvTmp);
+            report.verticalSpeed = Units::Speed::fromFPM(64.0*vvTmp);
         } else {
-            vSpeed = Units::Speed::fromFPM(-64.0*((1<<12)-vvTmp));
+            report.verticalSpeed = Units::Speed::fromFPM(-64.0*((1<<12)-vvTmp));
         }
-        pInfo.setAttribute(QGeoPositionInfo::VerticalSpeed, vSpeed.toMPS() );
     }
 
-    // Find true track if available
-    auto mm0 = static_cast<quint8>(decodedData.at(11)) & 0x03U;
-    if (mm0 == 1)  {
-        auto tt = static_cast<quint8>(decodedData.at(16));
-        pInfo.setAttribute(QGeoPositionInfo::Direction, tt*360.0/256.0 );
+    // True track
+    if ((data[11] & 0x03U) == 1)  {
+        report.track = data[16]*360.0/256.0;
+    }
+
+    // Emitter category and call sign
+    report.emitterCategory = data[17];
+    report.callSign = QByteArrayView(data+18, 8);
+    return true;
+}
+
+// Position info for an ownship or traffic report, without altitude
+auto pInfoFromReport(const GDL90Report& report) -> QGeoPositionInfo
+{
+    // Construct coordinate, generate position info
+    QGeoCoordinate coordinate(report.latitude, report.longitude);
+    if (!coordinate.isValid()) {
+        return {};
     }
+    QGeoPositionInfo pInfo(coordinate, QDateTime::currentDateTimeUtc());
 
+    if (qIsFinite(report.horizontalAccuracyInM)) {
+        pInfo.setAttribute(QGeoPositionInfo::HorizontalAccuracy, report.horizontalAccuracyInM);
+    }
+    if (report.groundSpeed.isFinite()) {
+        pInfo.setAttribute(QGeoPositionInfo::GroundSpeed, report.groundSpeed.toMPS() );
+    }
+    if (report.verticalSpeed.isFinite()) {
+        pInfo.setAttribute(QGeoPositionInfo::VerticalSpeed, report.verticalSpeed.toMPS() );
+    }
+    if (qIsFinite(report.track)) {
+        pInfo.setAttribute(QGeoPositionInfo::Direction, report.track );
+    }
     return pInfo;
 }
 
+} // namespace
+
 
 // Member functions
 
-void Traffic::TrafficDataSource_Abstract::processGDLMessage(const QByteArray& rawMessage)
+void Traffic::TrafficDataSource_Abstract::processGDLMessage(QByteArrayView rawMessage)
 {
 
     //
     // Do some trivial consistency checks
     //
 
-    if (rawMessage.size() < 3) {
+    if ((rawMessage.size() < 3) || (rawMessage.size() > maxGDLMessageSize)) {
         return;
     }
 
 
     //
-    // Escape character decoding.
+    // Escape character decoding. Most messages do not contain escape
+    // characters; these are used in place. Otherwise, the message is decoded
+    // into a buffer on the stack, copying the runs between escape characters
+    // in one go.
     //
-    QByteArray message;
-    {
-        message.reserve(rawMessage.size());
-        bool isEscaped = false;
-        foreach(auto byte, rawMessage) {
-            if (byte == 0x7d) {
-                isEscaped = true;
-                continue;
+    std::array<quint8, maxGDLMessageSize> buffer {};
+    const auto* message = reinterpret_cast<const quint8*>(rawMessage.data());
+    auto messageSize = rawMessage.size();
+    if (memchr(message, 0x7d, messageSize) != nullptr) {
+        qsizetype size = 0;
+        const auto* pos = message;
+        const auto* end = message+messageSize;
+        while (pos < end) {
+            const auto* escape = static_cast<const quint8*>(memchr(pos, 0x7d, end-pos));
+            if (escape == nullptr) {
+                escape = end;
+            }
+            memcpy(buffer.data()+size, pos, escape-pos);
+            size += escape-pos;
+            if (escape == end) {
+                break;
             }
-            if (isEscaped) {
-                message.append( static_cast<char>(static_cast<quint8>(byte) ^ static_cast<quint8>('\x20')) );
-                isEscaped = false;
-                continue;
+            if (escape+1 == end) {
+                return;
             }
-            message.append(byte);
+            buffer[size++] = static_cast<quint8>(escape[1] ^ 0x20U);
+            pos = escape+2;
         }
-        if (isEscaped) {
+        message = buffer.data();
+        messageSize = size;
+        if (messageSize < 3) {
             return;
         }
     }
@@ -210,25 +274,21 @@ void Traffic::TrafficDataSource_Abstract::processGDLMessage(const QByteArray& ra
     // CRC Checksum verification
     //
     {
-        quint16 crc = 0;
-        foreach(auto byte, message.chopped(2)) {
-            crc = Crc16Table.at(crc >> 8U) ^ (crc << 8U) ^ static_cast<quint8>(byte);
-        }
+        auto crc = crc16(message, messageSize-2);
 
         // Extract CRC checksum from data
-        quint16 savedCRC = 0;
-        savedCRC += static_cast<quint8>( message.at(message.size()-1) );
-        savedCRC = (savedCRC << 8U) + static_cast<quint8>( message.at(message.size()-2) );
+        quint16 savedCRC = message[messageSize-1];
+        savedCRC = (savedCRC << 8U) + message[messageSize-2];
         if (crc != savedCRC) {
             return;
         }
     }
 
 
-    // Extract Message ID, cut off Message ID and checksum from decodedData
-    auto messageID = static_cast<quint8>( message.at(0) );
-    message.chop(2);
-    message = message.mid(1);
+    // Extract Message ID, cut off Message ID and checksum
+    auto messageID = message[0];
+    const auto* payload = message+1;
+    auto payloadSize = messageSize-3;
 
 
     //
@@ -237,13 +297,13 @@ void Traffic::TrafficDataSource_Abstract::processGDLMessage(const QByteArray& ra
 
     // Heartbeat message
     if (messageID == 0) {
-        if (message.length() < 3) {
+        if (payloadSize < 3) {
             return;
         }
 
         // Handle runtime errors
         QStringList results;
-        auto status = static_cast<quint8>(message.at(0));
+        auto status = payload[0];
         if ((status & 1<<7) == 0) {
             results += tr("No GPS reception");
         }
@@ -262,7 +322,11 @@ void Traffic::TrafficDataSource_Abstract::processGDLMessage(const QByteArray& ra
     // Ownship report
     if (messageID == 10) {
         // Get position info w/o altitude information
-        auto pInfo = pInfoFromOwnshipReport(message);
+        GDL90Report report;
+        if (!decodeReport(payload, payloadSize, report)) {
+            return;
+        }
+        auto pInfo = pInfoFromReport(report);
         if (!pInfo.isValid()) {
             return;
         }
@@ -276,14 +340,10 @@ void Traffic::TrafficDataSource_Abstract::processGDLMessage(const QByteArray& ra
         }
 
         // Find pressure altitude and update information if need be
-        auto dd0 = static_cast<quint8>(message.at(10));
-        auto dd1 = static_cast<quint8>(message.at(11));
-        quint32 ddTmp = (dd0 << 4) + (dd1 >> 4);
-        if (ddTmp != 0xFFF) {
-            m_pressureAltitude = Units::Distance::fromFT(25.0*ddTmp - 1000.0);
+        m_pressureAltitude = report.pressureAltitude;
+        if (m_pressureAltitude.isFinite()) {
             m_pressureAltitudeTimer.start();
         } else {
-            m_pressureAltitude = Units::Distance::fromM( qQNaN() );
             m_pressureAltitudeTimer.stop();
         }
         emit pressureAltitudeUpdated(m_pressureAltitude);
@@ -295,9 +355,13 @@ void Traffic::TrafficDataSource_Abstract::processGDLMessage(const QByteArray& ra
 
     // Ownship geometric altitude
     if (messageID == 11) {
+        if (payloadSize < 4) {
+            return;
+        }
+
         // Find geometric alt and apply geoid correction
-        auto dd0 = static_cast<quint8>(message.at(0));
-        auto dd1 = static_cast<quint8>(message.at(1));
+        auto dd0 = payload[0];
+        auto dd1 = payload[1];
         qint32 ddInt = (dd0 << 8) + dd1;
         if (ddInt > 32767) {
             ddInt -= 65536;
@@ -309,8 +373,8 @@ void Traffic::TrafficDataSource_Abstract::processGDLMessage(const QByteArray& ra
         }
 
         // Find geometric figure of merit
-        auto vm0 = static_cast<quint8>(message.at(2)) & 0x7FU;
-        auto vm1 = static_cast<quint8>(message.at(3));
+        auto vm0 = payload[2] & 0x7FU;
+        auto vm1 = payload[3];
         auto vmInt = (vm0 << 8) + vm1;
         m_trueAltitudeFOM = Units::Distance::fromM(vmInt);
         m_trueAltitudeTimer.start();
@@ -322,24 +386,26 @@ void Traffic::TrafficDataSource_Abstract::processGDLMessage(const QByteArray& ra
     if (messageID == 20) {
 
         // Get position info w/o altitude information
-        auto pInfo = pInfoFromOwnshipReport(message);
+        GDL90Report report;
+        if (!decodeReport(payload, payloadSize, report)) {
+            return;
+        }
+        auto pInfo = pInfoFromReport(report);
         if (!pInfo.isValid()) {
             return;
         }
 
         // Get ID
-        auto id0 = static_cast<quint8>(message.at(0)) & 0x0FU;
-        auto id1 = static_cast<quint8>(message.at(1));
-        auto id2 = static_cast<quint8>(message.at(2));
-        auto id3 = static_cast<quint8>(message.at(3));
-        auto id = QString::number(id0, 16) + QString::number(id1, 16) + QString::number(id2, 16) + QString::number(id3, 16);
+        auto id = QString::number(report.addressType, 16)
+                  + QString::number((report.address >> 16U) & 0xFFU, 16)
+                  + QString::number((report.address >> 8U) & 0xFFU, 16)
+                  + QString::number(report.address & 0xFFU, 16);
 
         // Alert
-        auto s0 = static_cast<quint8>(message.at(0)) >> 4;
-        auto alert = (s0 == 1) ? 1 : 0;
+        auto alert = (report.alertStatus == 1) ? 1 : 0;
 
         // Traffic type
-        auto ee = static_cast<quint8>(message.at(17));
+        auto ee = report.emitterCategory;
         auto type = Traffic::TrafficFactor_Abstract::unknown;
         switch(ee) {
         case 1:
@@ -378,12 +444,8 @@ void Traffic::TrafficDataSource_Abstract::processGDLMessage(const QByteArray& ra
         // a recent pressure altitude reading for owncraft exists.
         Units::Distance vDist {};
         if (m_pressureAltitudeTimer.isActive()) {
-            auto dd0 = static_cast<quint8>(message.at(10));
-            auto dd1 = static_cast<quint8>(message.at(11));
-            quint32 ddTmp = (dd0 << 4) + (dd1 >> 4);
-            if (ddTmp != 0xFFF) {
-                auto trafficPressureAltitude = Units::Distance::fromFT(25.0*ddTmp - 1000.0);
-                vDist = trafficPressureAltitude - m_pressureAltitude;
+            if (report.pressureAltitude.isFinite()) {
+                vDist = report.pressureAltitude - m_pressureAltitude;
 
                 // Compute true altitude of traffic if possible
                 if (m_trueAltitudeTimer.isActive()) {
@@ -408,7 +470,7 @@ void Traffic::TrafficDataSource_Abstract::processGDLMessage(const QByteArray& ra
         }
 
         // Callsign of traffic
-        auto callSign = QString::fromLatin1(message.mid(18,8)).simplified();
+        auto callSign = QString::fromLatin1(report.callSign).simplified();
 
         // Expose data
         if ((callSign.compare(u"MODE S"_qs, Qt::CaseInsensitive) == 0) || (callSign.compare(u"MODE-S"_qs, Qt::CaseInsensitive) == 0)) {
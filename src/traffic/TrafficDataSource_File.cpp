@@ -50,7 +50,7 @@ void Traffic::TrafficDataSource_File::connectToTrafficReceiver()
     if (simulatorFile.open(QIODevice::ReadOnly)) {
         simulatorTextStream.setDevice(&simulatorFile);
         simulatorTextStream.setEncoding(QStringConverter::Latin1);
-        lastPayload = QString();
+        lastPayload = QByteArray();
         lastTime = 0;
         readFromSimulatorStream();
     }
@@ -124,7 +124,7 @@ void Traffic::TrafficDataSource_File::readFromSimulatorStream()
         return;
     }
     auto time = tuple[0].toInt();
-    lastPayload = tuple[1];
+    lastPayload = tuple[1].toLatin1();
 
     if (lastTime == 0) {
         simulatorTimer.setInterval(0);
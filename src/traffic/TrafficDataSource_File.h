@@ -100,7 +100,7 @@ private:
     QTextStream simulatorTextStream;
     QTimer simulatorTimer;
     int lastTime {0};
-    QString lastPayload;
+    QByteArray lastPayload;
 };
 
 } // namespace Traffic
@@ -18,6 +18,8 @@
  *   59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.             *
  ***************************************************************************/
 
+#include <cstring>
+
 #include "GlobalObject.h"
 #include "platform/PlatformAdaptor_Abstract.h"
 #include "traffic/PasswordDB.h"
@@ -34,10 +36,6 @@ Traffic::TrafficDataSource_Tcp::TrafficDataSource_Tcp(QString hostName, quint16
     connect(&m_socket, &QTcpSocket::stateChanged, this, &Traffic::TrafficDataSource_Tcp::onStateChanged);
     connect(&m_socket, &QAbstractSocket::disconnected, this, &Traffic::TrafficDataSource_Tcp::connectToTrafficReceiver, Qt::ConnectionType::QueuedConnection);
 
-    // Set up text stream
-    m_textStream.setDevice(&m_socket);
-    m_textStream.setEncoding(QStringConverter::Latin1);
-
     //
     // Initialize properties
     //
@@ -71,7 +69,8 @@ void Traffic::TrafficDataSource_Tcp::connectToTrafficReceiver()
     m_socket.setSocketOption(QAbstractSocket::LowDelayOption, 1);
     m_socket.setSocketOption(QAbstractSocket::KeepAliveOption, 1);
     m_socket.connectToHost(m_hostName, m_port);
-    m_textStream.setDevice(&m_socket);
+    m_receiveBufferBegin = 0;
+    m_receiveBufferEnd = 0;
 
     // Update properties
     onStateChanged(m_socket.state());
@@ -96,27 +95,74 @@ void Traffic::TrafficDataSource_Tcp::disconnectFromTrafficReceiver()
 
 void Traffic::TrafficDataSource_Tcp::onReadyRead()
 {
+    auto* data = m_receiveBuffer.data();
 
-    QString sentence;
-    while( m_textStream.readLineInto(&sentence) ) {
+    while (m_socket.bytesAvailable() > 0) {
 
-        // Check if the TCP connection asks for a password
-        if (sentence.startsWith(u"PASS?"_qs)) {
-            passwordRequest_Status = waitingForPassword;
-            passwordRequest_SSID = GlobalObject::platformAdaptor()->currentSSID();
-            auto* passwordDB = GlobalObject::passwordDB();
-            if (passwordDB->contains(passwordRequest_SSID)) {
-                setPassword(passwordRequest_SSID, passwordDB->getPassword(passwordRequest_SSID));
+        // Make room in the receive buffer. Move incomplete line to the front
+        // of the buffer. If the buffer is filled with a single line, then
+        // this cannot be a valid sentence and we discard the data.
+        if (m_receiveBufferEnd == receiveBufferSize) {
+            if (m_receiveBufferBegin == 0) {
+                m_receiveBufferEnd = 0;
             } else {
-                emit passwordRequest(passwordRequest_SSID);
+                memmove(data, data+m_receiveBufferBegin, m_receiveBufferEnd-m_receiveBufferBegin);
+                m_receiveBufferEnd -= m_receiveBufferBegin;
+                m_receiveBufferBegin = 0;
+            }
+        }
+
+        // Read raw bytes into the buffer
+        auto bytesRead = m_socket.read(data+m_receiveBufferEnd, receiveBufferSize-m_receiveBufferEnd);
+        if (bytesRead <= 0) {
+            break;
+        }
+        auto scanStart = m_receiveBufferEnd;
+        m_receiveBufferEnd += bytesRead;
+
+        // Process complete lines in place. Only the newly read bytes need to
+        // be scanned for line breaks.
+        while (scanStart < m_receiveBufferEnd) {
+            auto* lineBreak = static_cast<char*>(memchr(data+scanStart, '\n', m_receiveBufferEnd-scanStart));
+            if (lineBreak == nullptr) {
+                break;
+            }
+            auto lineEnd = lineBreak-data;
+            processLine(QByteArrayView(data+m_receiveBufferBegin, lineEnd-m_receiveBufferBegin));
+
+            // Slots connected to signals emitted while processing the line
+            // might have restarted the connection and reset the buffer.
+            if (m_receiveBufferEnd == 0) {
+                return;
             }
-            continue;
+            m_receiveBufferBegin = lineEnd+1;
+            scanStart = lineEnd+1;
         }
+        if (m_receiveBufferBegin == m_receiveBufferEnd) {
+            m_receiveBufferBegin = 0;
+            m_receiveBufferEnd = 0;
+        }
+    }
+}
+
 
-        // Process FLARM sentence
-        processFLARMSentence(sentence);
+void Traffic::TrafficDataSource_Tcp::processLine(QByteArrayView line)
+{
+    // Check if the TCP connection asks for a password
+    if (line.startsWith("PASS?")) {
+        passwordRequest_Status = waitingForPassword;
+        passwordRequest_SSID = GlobalObject::platformAdaptor()->currentSSID();
+        auto* passwordDB = GlobalObject::passwordDB();
+        if (passwordDB->contains(passwordRequest_SSID)) {
+            setPassword(passwordRequest_SSID, passwordDB->getPassword(passwordRequest_SSID));
+        } else {
+            emit passwordRequest(passwordRequest_SSID);
+        }
+        return;
     }
 
+    // Process FLARM sentence
+    processFLARMSentence(line);
 }
 
 
@@ -177,8 +223,8 @@ void Traffic::TrafficDataSource_Tcp::sendPassword_internal()
     connect(this, &Traffic::TrafficDataSource_Abstract::receivingHeartbeatChanged, this, &Traffic::TrafficDataSource_Tcp::updatePasswordStatusOnHeartbeatChange);
     connect(&m_socket, &QTcpSocket::disconnected, this, &Traffic::TrafficDataSource_Tcp::updatePasswordStatusOnDisconnected);
 
-    m_textStream << passwordRequest_password+"\n";
-    m_textStream.flush();
+    m_socket.write((passwordRequest_password+u"\n"_qs).toLatin1());
+    m_socket.flush();
     passwordRequest_Status = waitingForDevice;
 
 }
@@ -20,6 +20,8 @@
 
 #pragma once
 
+#include <array>
+
 #include <QPointer>
 #include <QTcpSocket>
 
@@ -91,8 +93,8 @@ public slots:
     void setPassword(const QString& SSID, const QString& password) override;
 
 private slots:
-    // Read lines from the socket's text stream and passes the string on to
-    // processFLARMMessage.
+    // Reads raw bytes from the socket into the receive buffer and passes
+    // complete lines on to processLine().
     void onReadyRead();
 
     // This method does the actual job of sending the password to the traffic
@@ -124,11 +126,24 @@ private slots:
     void updatePasswordStatusOnHeartbeatChange(bool newHeartbeat);
 
 private:
+    // Handles one line received from the socket, without trailing line break.
+    // Password requests are handled here, all other lines are passed on to
+    // processFLARMSentence().
+    void processLine(QByteArrayView line);
+
     QTcpSocket m_socket;
-    QTextStream m_textStream;
     QString m_hostName;
     quint16 m_port;
 
+    // Receive buffer. Bytes are read from the socket directly into this
+    // buffer; lines are framed in place and passed to the parser without
+    // copying or decoding. The bytes between m_receiveBufferBegin and
+    // m_receiveBufferEnd are an incomplete line, waiting for more data.
+    static constexpr qsizetype receiveBufferSize = 8*1024;
+    std::array<char, receiveBufferSize> m_receiveBuffer {};
+    qsizetype m_receiveBufferBegin {0};
+    qsizetype m_receiveBufferEnd {0};
+
 
     /* Password lifecycle
      *
@@ -18,7 +18,7 @@
  *   59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.             *
  ***************************************************************************/
 
-#include <QNetworkDatagram>
+#include <cstring>
 
 #include "traffic/TrafficDataSource_Udp.h"
 
@@ -101,18 +101,23 @@ void Traffic::TrafficDataSource_Udp::onReadyRead()
     }
 
     // Read datagrams
+    auto* buffer = m_datagramBuffer.data();
     while (m_socket->hasPendingDatagrams())
     {
-        QByteArray data = m_socket->receiveDatagram().data();
+        // Read datagram directly into the buffer. Datagrams that do not fit
+        // into the buffer are truncated.
+        auto size = m_socket->readDatagram(buffer, maxDatagramSize);
+        if (size <= 0)
+        {
+            continue;
+        }
+        QByteArrayView data(buffer, size);
 
-        // Return immediately if the datagram has already been received.
+        // Ignore the datagram if it has already been received.
         auto currentDatagramHash = qHash(data);
-        foreach(auto hash, receivedDatagramHashes)
+        if (receivedDatagramHashes.contains(currentDatagramHash))
         {
-            if (hash == currentDatagramHash)
-            {
-                return;
-            }
+            continue;
         }
         receivedDatagramHashes[nextHashIndex] = currentDatagramHash;
         nextHashIndex = (nextHashIndex+1) % receivedDatagramHashes.size();
@@ -120,19 +125,26 @@ void Traffic::TrafficDataSource_Udp::onReadyRead()
         // Process datagrams, depending on content type
         if (data.startsWith("XGPS") || data.startsWith("XTRA"))
         {
-            processXGPSString(data);
+            processXGPSString(QByteArray::fromRawData(buffer, size));
+            continue;
         }
-        else
+
+        // Split data into raw messages, which are separated by 0x7e flag
+        // bytes, and process them in place
+        const auto* pos = buffer;
+        const auto* end = buffer+size;
+        while (pos < end)
         {
-            // Split data into raw messages
-            foreach(auto rawMessage, data.split(0x7e))
+            const auto* flag = static_cast<const char*>(memchr(pos, 0x7e, end-pos));
+            if (flag == nullptr)
             {
-                if (!rawMessage.isEmpty())
-                {
-                    processGDLMessage(rawMessage);
-                }
+                flag = end;
             }
-
+            if (flag > pos)
+            {
+                processGDLMessage(QByteArrayView(pos, flag-pos));
+            }
+            pos = flag+1;
         }
     }
 
@@ -20,6 +20,7 @@
 
 #pragma once
 
+#include <array>
 
 #include <QPointer>
 #include <QUdpSocket>
@@ -82,8 +83,8 @@ public slots:
     void disconnectFromTrafficReceiver() override;
 
 private slots:
-    // Read messages from the socket datagrams and passes the messages on to
-    // processGDLMessage
+    // Read datagrams from the socket, split them into messages in place and
+    // pass the messages on to processGDLMessage
     void onReadyRead();
 
 private:
@@ -93,9 +94,14 @@ private:
     // We use this vector to store the last 512 datatgram hashes in a circular
     // array. This is used to sort out doubly sent datagrams. The nextHashIndex
     // points to the next vector entry that will be re-written.
-    QVector<uint> receivedDatagramHashes {512, 0};
+    QVector<size_t> receivedDatagramHashes {512, 0};
     qsizetype nextHashIndex {0};
 
+    // Receive buffer. Datagrams are read into this buffer and decoded in
+    // place.
+    static constexpr qsizetype maxDatagramSize = 64*1024;
+    std::array<char, maxDatagramSize> m_datagramBuffer {};
+
     // GPS altitude of owncraft
     Units::Distance m_trueAltitude;
     Units::Distance m_trueAltitude_FOM;
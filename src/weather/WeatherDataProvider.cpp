@@ -60,6 +60,7 @@ Weather::WeatherDataProvider::WeatherDataProvider(QObject *parent) : QObject(par
     _deleteExiredMessagesTimer.start();
 
     // Update the description text when needed
+    connect(this, &Weather::WeatherDataProvider::weatherStationsChanged, this, [this]() { _stationIndexDirty = true; });
     connect(this, &Weather::WeatherDataProvider::weatherStationsChanged, this, &Weather::WeatherDataProvider::QNHInfoChanged);
 
     // Set up connections to other static objects, but do so with a little lag to avoid conflicts in the initialisation
@@ -255,7 +256,9 @@ auto Weather::WeatherDataProvider::findOrConstructWeatherStation(const QString &
     }
 
     auto *newWeatherStation = new Weather::Station(ICAOCode, GlobalObject::geoMapProvider(), this);
+    connect(newWeatherStation, &Weather::Station::coordinateChanged, this, [this]() { _stationIndexDirty = true; });
     _weatherStationsByICAOCode.insert(ICAOCode, newWeatherStation);
+    _stationIndexDirty = true;
     return newWeatherStation;
 }
 
@@ -484,36 +487,19 @@ auto Weather::WeatherDataProvider::QNHInfo() const -> QString
     }
 
     // Find QNH of nearest airfield
+    if (_stationIndexDirty)
+    {
+        rebuildStationIndex();
+    }
+    auto hasQNH = [this](qsizetype index) {
+        const auto& weatherStationPtr = _stationIndexStations[index];
+        return !weatherStationPtr.isNull() && (weatherStationPtr->metar() != nullptr) && (weatherStationPtr->metar()->QNH() != 0);
+    };
     Weather::Station *closestReportWithQNH = nullptr;
-    int QNH = 0;
-    foreach(auto weatherStationPtr, _weatherStationsByICAOCode) {
-        if (weatherStationPtr.isNull())
-        {
-            continue;
-        }
-        if (weatherStationPtr->metar() == nullptr)
-        {
-            continue;
-        }
-        QNH = weatherStationPtr->metar()->QNH();
-        if (QNH == 0)
-        {
-            continue;
-        }
-        if (!weatherStationPtr->coordinate().isValid())
-        {
-            continue;
-        }
-        if (closestReportWithQNH == nullptr) {
-            closestReportWithQNH = weatherStationPtr;
-            continue;
-        }
-
-        QGeoCoordinate here = Positioning::PositionProvider::lastValidCoordinate();
-        if (here.distanceTo(weatherStationPtr->coordinate()) < here.distanceTo(closestReportWithQNH->coordinate()))
-        {
-            closestReportWithQNH = weatherStationPtr;
-        }
+    auto nearest = _stationIndex.nearest(Positioning::PositionProvider::lastValidCoordinate(), 1, hasQNH);
+    if (!nearest.isEmpty())
+    {
+        closestReportWithQNH = _stationIndexStations[nearest[0]];
     }
     if (closestReportWithQNH != nullptr)
     {
@@ -525,6 +511,23 @@ auto Weather::WeatherDataProvider::QNHInfo() const -> QString
 }
 
 
+void Weather::WeatherDataProvider::rebuildStationIndex() const
+{
+    _stationIndexStations.clear();
+    QVector<QGeoCoordinate> coordinates;
+    foreach(auto weatherStationPtr, _weatherStationsByICAOCode) {
+        if (weatherStationPtr.isNull())
+        {
+            continue;
+        }
+        _stationIndexStations.append(weatherStationPtr);
+        coordinates.append(weatherStationPtr->coordinate());
+    }
+    _stationIndex = GeoMaps::KDTree(coordinates);
+    _stationIndexDirty = false;
+}
+
+
 void Weather::WeatherDataProvider::update(bool isBackgroundUpdate)
 {
 
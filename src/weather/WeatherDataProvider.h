@@ -29,6 +29,7 @@ class QNetworkAccessManager;
 class QNetworkReply;
 
 #include "GlobalObject.h"
+#include "geomaps/KDTree.h"
 #include "weather/Station.h"
 
 class FlightRoute;
@@ -281,6 +282,15 @@ private:
     // List of weather stations, accessible by ICAO code
     QMap<QString, QPointer<Weather::Station>> _weatherStationsByICAOCode;
 
+    // Spatial index for the weather stations, used to find the nearest
+    // station with QNH. Items of the index are indices into
+    // _stationIndexStations. The index is rebuilt lazily, after the list of
+    // weather stations or the coordinate of any station has changed.
+    void rebuildStationIndex() const;
+    mutable GeoMaps::KDTree _stationIndex;
+    mutable QVector<QPointer<Weather::Station>> _stationIndexStations;
+    mutable bool _stationIndexDirty {true};
+
     // Date and Time of last update
     QDateTime _lastUpdate;
 };